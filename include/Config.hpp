@@ -34,6 +34,10 @@ class Config
 
     MainSolverType main_solver_type{0};
 
+    /*Constant dynamic viscosity and Prandtl number of the Navier-Stokes solver*/
+    Scalar dynamic_viscosity{0.0};
+    Scalar prandtl_number{0.0};
+
     TimeIntegrationType time_integration_type{0};
 
     TimeScheme time_scheme{0};
@@ -46,10 +50,96 @@ class Config
 
     Limiter limiter{0};
 
+    Scalar venkatakrishnan_K{0.0};
+
+    /*The limiter values are frozen (no longer updated) after the given number of time steps or when the
+    residual has dropped by the given number of orders of magnitude. Only meant for steady cases. 0 = never*/
+    size_t freeze_limiter_timestep{0};
+
+    Scalar freeze_limiter_residual_drop{0.0};
+
+    /*If enabled, the limiter is only computed in cells flagged by a pressure based shock sensor,
+    all other cells have a limiter value of 1*/
+    bool limiter_shock_sensor{false};
+
+    Scalar shock_sensor_threshold{0.0};
+
+    /*With fast math kernels the square roots and powers of the Euler equations are approximated, see FastMath.hpp.
+    The number of Newton iterations of the kernels is the lowest one meeting the tolerance, set at startup*/
+    MathKernels math_kernels{0};
+
+    Scalar fast_math_tolerance{0.0};
+
+    ShortIndex fast_math_iterations{0};
+
+    /*If false, no primitive variables are stored for the ghost cells. The boundary states are then computed from
+    the boundary conditions inside the gradient and limiter loops instead of in a separate pass*/
+    bool store_ghost_cells{true};
+
+    /*Advises the kernel to back the solution fields with transparent huge pages, see FieldAllocator.hpp*/
+    bool huge_pages{false};
+
+    /*If > 0, the interior faces are processed in tiles whose cell data fit in the given size, see
+    EulerSolver::create_face_tiles. Meant to be about the size of the L2 cache. Only for the serial flux loop, see
+    ConfigParser::infer_hidden_options*/
+    size_t face_tile_size_kb{0};
+
+    /*If > 0, the second and third stage of TVD_RK3 are advanced block by block, with blocks of cells whose data
+    fit in the given size, see Solver::create_cell_blocks*/
+    size_t temporal_block_size_kb{0};
+
+    /*If > 0, the flux balance is evaluated as a graph of tasks on this many cell partitions instead of phase by
+    phase over all cells, see EulerSolver::create_flux_balance_task_graph*/
+    Index task_partitions{0};
+
+    /*If > 0, the steps between full sweeps only evaluate and update the active cells. A cell is active if one of
+    its conservative variables changed by more than activity_tolerance times its free stream scale (density,
+    density times sound speed for the momentum, density times sound speed squared for the energy and density for
+    the passive scalars) in the last step, or if it lies within activity_halo layers of such a cell. The activity
+    is taken per block of activity_block_size consecutive cells, a block being active with any of its cells,
+    which only pays off if consecutive cells are close in the mesh. Every activity_full_sweep_interval steps,
+    starting with the first, all cells are evaluated and updated. Inactive cells keep their state and the spectral
+    radius of their last evaluation. The active cells are evaluated serially, see EulerSolver::update_activity*/
+    Scalar activity_tolerance{0.0};
+    ShortIndex activity_halo{2};
+    Index activity_block_size{1};
+    size_t activity_full_sweep_interval{20};
+
+    /*Threads of the pool shared by the grid, the solvers and the output, and the number of indices its loops hand
+    out at a time, see ThreadPool.hpp. The flux balance tasks of task_partitions run on the pool as well*/
+    ShortIndex n_threads{1};
+    Index chunk_size{1024};
+
+    /*With more than one thread, the face loops of the fluxes and the Green-Gauss gradient either store the face
+    values and sum them per cell, in the same order as the serial loops, or add them to the cells with atomic
+    updates. The first gives results independent of the number of threads at the cost of an extra pass over the
+    faces of each cell and a buffer of face fluxes, the second results that vary in the last bits between runs.
+    Face tiles are only used by the serial flux loop*/
+    bool deterministic_accumulation{true};
+
+    /*Cores the threads of the pool are pinned to. Compact fills the NUMA nodes one after the other, Scatter
+    distributes the threads round robin over the nodes and List takes the cores in thread_cores, thread w getting
+    thread_cores[w]. Can be overridden with the environment variables NETFLUX_THREAD_AFFINITY and
+    NETFLUX_THREAD_CORES (as in "0-3,8"). Thread w always starts the cell loops on the same range of cells, also
+    when zeroing the fields, so the pages of a range are placed on the node of the thread using them. The flux balance
+    tasks of task_partitions run on the same pinned threads*/
+    ThreadAffinity thread_affinity{ThreadAffinity::None};
+    Vector<int> thread_cores;
+
     InitialConditionOption initial_cond_option{0};
 
+    /*Passive scalars phi carried by the flow of the Euler solver, with their initial value in the domain and the
+    value entering through the far field boundaries, see PassiveScalarData*/
+    Vector<string> passive_scalar_names;
+    Vector<Scalar> passive_scalar_initial_values;
+    Vector<Scalar> passive_scalar_freestream_values;
+
     size_t n_timesteps{0};
 
+    /*If > 0, the run stops before n_timesteps once the L2 norm of the density residual has dropped by the given
+    number of orders of magnitude from the first time step, see Driver::residual_converged. 0 = never*/
+    Scalar convergence_tolerance{0.0};
+
     size_t write_stride{0};
 
     size_t timestep{0};
@@ -60,6 +150,11 @@ class Config
 
     Scalar CFL{0.0};
 
+    /*If true, each cell advances with its own time step 2 * CFL * Omega_i / Lambda_i instead of the smallest one
+    over all cells, see EulerSolver::calc_timestep. Only meant for steady cases, the time of the solution is then
+    only the sum of the smallest time steps*/
+    bool local_time_stepping{false};
+
     bool grid_motion{false};
 
     Scalar primvars_inf[N_EQS_EULER]{0.0}; // May be used for setting initial values or boundary conditions
@@ -110,6 +205,10 @@ public:
     MainSolverType get_main_solver_type() const { return main_solver_type; }
     void set_main_solver_type(MainSolverType val) { main_solver_type = val; }
 
+    Scalar get_dynamic_viscosity() const { return dynamic_viscosity; }
+
+    Scalar get_prandtl_number() const { return prandtl_number; }
+
     TimeIntegrationType get_time_integration_type() const { return time_integration_type; }
 
     TimeScheme get_time_scheme() const { return time_scheme; }
@@ -127,11 +226,66 @@ public:
     Limiter get_limiter() const { return limiter; }
     void set_limiter(Limiter val) { limiter = val; }
 
+    Scalar get_venkatakrishnan_K() const { return venkatakrishnan_K; }
+
+    size_t get_freeze_limiter_timestep() const { return freeze_limiter_timestep; }
+
+    Scalar get_freeze_limiter_residual_drop() const { return freeze_limiter_residual_drop; }
+
+    bool get_limiter_shock_sensor() const { return limiter_shock_sensor; }
+
+    Scalar get_shock_sensor_threshold() const { return shock_sensor_threshold; }
+
+    MathKernels get_math_kernels() const { return math_kernels; }
+
+    Scalar get_fast_math_tolerance() const { return fast_math_tolerance; }
+
+    ShortIndex get_fast_math_iterations() const { return fast_math_iterations; }
+    void set_fast_math_iterations(ShortIndex val) { fast_math_iterations = val; }
+
+    bool get_store_ghost_cells() const { return store_ghost_cells; }
+
+    bool get_huge_pages() const { return huge_pages; }
+
+    size_t get_face_tile_size_kb() const { return face_tile_size_kb; }
+
+    size_t get_temporal_block_size_kb() const { return temporal_block_size_kb; }
+
+    Index get_task_partitions() const { return task_partitions; }
+
+    Scalar get_activity_tolerance() const { return activity_tolerance; }
+
+    ShortIndex get_activity_halo() const { return activity_halo; }
+
+    Index get_activity_block_size() const { return activity_block_size; }
+
+    size_t get_activity_full_sweep_interval() const { return activity_full_sweep_interval; }
+
+    ShortIndex get_n_threads() const { return n_threads; }
+
+    Index get_chunk_size() const { return chunk_size; }
+
+    bool get_deterministic_accumulation() const { return deterministic_accumulation; }
+
+    ThreadAffinity get_thread_affinity() const { return thread_affinity; }
+
+    const Vector<int> &get_thread_cores() const { return thread_cores; }
+
     InitialConditionOption get_initial_cond_option() const { return initial_cond_option; }
     void set_initial_cond_option(InitialConditionOption val) { initial_cond_option = val; }
 
+    ShortIndex get_N_PASSIVE_SCALARS() const { return passive_scalar_names.size(); }
+
+    const Vector<string> &get_passive_scalar_names() const { return passive_scalar_names; }
+
+    const Vector<Scalar> &get_passive_scalar_initial_values() const { return passive_scalar_initial_values; }
+
+    const Vector<Scalar> &get_passive_scalar_freestream_values() const { return passive_scalar_freestream_values; }
+
     size_t get_n_timesteps() const { return n_timesteps; }
 
+    Scalar get_convergence_tolerance() const { return convergence_tolerance; }
+
     size_t get_timestep() const { return timestep; }
     void set_timestep(size_t val) { timestep = val; }
 
@@ -144,6 +298,8 @@ public:
     Scalar get_CFL() const { return CFL; }
     void set_CFL(Scalar val) { CFL = val; }
 
+    bool get_local_time_stepping() const { return local_time_stepping; }
+
     size_t get_write_stride() const { return write_stride; }
 
     bool get_grid_motion() const { return grid_motion; }
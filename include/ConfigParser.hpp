@@ -138,5 +138,7 @@ private:
 
     void read_patches(Config &config);
 
+    void read_passive_scalars(Config &config);
+
     void set_mesh_name(Config &config);
 };
\ No newline at end of file
@@ -3,10 +3,14 @@
 #include "Grid.hpp"
 #include "Output.hpp"
 #include "Solver.hpp"
+#include "ThreadPool.hpp"
 
 
 class Driver{
     Config& config;
+
+    /*Shared by the grid, the solvers and the output. Declared first, so that it outlives them*/
+    unique_ptr<ThreadPool> thread_pool;
     
     unique_ptr<geom::Grid> grid;
 
@@ -14,6 +18,10 @@ class Driver{
 
     unique_ptr<Output> output;
 
+    /*True if the L2 norm of the density residual has dropped by convergence_tolerance orders of magnitude from the
+    first time step. Steps without current residual norms are not checked*/
+    bool residual_converged();
+
 public:
     Driver(Config& config);
 
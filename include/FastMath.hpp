@@ -0,0 +1,95 @@
+#pragma once
+#include "Includes.hpp"
+#include "Utilities.hpp"
+
+/*Approximate kernels for the square roots and powers in the Euler equations, used with math_kernels: Fast.
+The kernels start from an estimate of the result read off the bit pattern of the argument and refine it with
+N_ITER Newton iterations, which only need multiplications. N_ITER = 0 gives the exact library functions.
+The exponents of the powers are fixed by gamma = 1.4*/
+namespace fast_math
+{
+    static_assert(standard_air::gamma == 1.4, "The fast power kernels assume gamma = 1.4");
+
+    /*Newton iteration counts the solver pipelines are compiled for, in increasing order of accuracy*/
+    constexpr array<ShortIndex, 2> newton_iteration_levels{2, 3};
+
+    /*Estimate of x^p for x > 0. Read as an integer, the bit pattern of a positive floating point number is roughly
+    a scaled and shifted log2 of its value, so that x^p = 2^(p * log2(x)) becomes a linear map of the bit pattern.
+    The shift of the origin is the usual choice minimizing the error of the estimate*/
+    inline Scalar power_estimate(Scalar x, Scalar p)
+    {
+        using Bits = std::conditional_t<sizeof(Scalar) == 8, uint64_t, uint32_t>;
+        using SignedBits = std::make_signed_t<Bits>;
+        constexpr ShortIndex N_MANTISSA_BITS = std::numeric_limits<Scalar>::digits - 1;
+        constexpr Bits ONE_BITS = Bits(std::numeric_limits<Scalar>::max_exponent - 1) << N_MANTISSA_BITS;
+        constexpr Bits ORIGIN = ONE_BITS - Bits(0.0450466 * Scalar(Bits(1) << N_MANTISSA_BITS));
+
+        Bits x_bits;
+        std::memcpy(&x_bits, &x, sizeof(Scalar));
+        const Bits y_bits = ORIGIN + SignedBits(p * Scalar(SignedBits(x_bits - ORIGIN)));
+        Scalar y;
+        std::memcpy(&y, &y_bits, sizeof(Scalar));
+        return y;
+    }
+
+    /*1 / sqrt(x)*/
+    template <ShortIndex N_ITER>
+    inline Scalar rsqrt(Scalar x)
+    {
+        assert(x > 0.0);
+        if constexpr (N_ITER == 0)
+            return 1 / std::sqrt(x);
+        else
+        {
+            Scalar y = power_estimate(x, -0.5);
+            for (ShortIndex k{0}; k < N_ITER; k++)
+                y *= 1.5 - 0.5 * x * y * y;
+            return y;
+        }
+    }
+
+    template <ShortIndex N_ITER>
+    inline Scalar sqrt(Scalar x)
+    {
+        if constexpr (N_ITER == 0)
+            return std::sqrt(x);
+        else
+            return x * rsqrt<N_ITER>(x);
+    }
+
+    /*x^(-gamma) = x^(-7/5). Newton iterations on y^(-5) = x^7. The initial estimate is about twice as far off as
+    the one of rsqrt, so one extra iteration is used to reach the same accuracy*/
+    template <ShortIndex N_ITER>
+    inline Scalar pow_minus_gamma(Scalar x)
+    {
+        assert(x > 0.0);
+        if constexpr (N_ITER == 0)
+            return std::pow(x, -standard_air::gamma);
+        else
+        {
+            const Scalar x_cubed = x * x * x;
+            const Scalar x_7 = x_cubed * x_cubed * x;
+            Scalar y = power_estimate(x, -1.4);
+            for (ShortIndex k{0}; k < N_ITER + 1; k++)
+            {
+                const Scalar y_sq = y * y;
+                y *= 1.2 - 0.2 * x_7 * y_sq * y_sq * y;
+            }
+            return y;
+        }
+    }
+
+    /*x^(1 / (gamma - 1)) = x^(5/2)*/
+    template <ShortIndex N_ITER>
+    inline Scalar pow_inv_gamma_minus_one(Scalar x)
+    {
+        if constexpr (N_ITER == 0)
+            return std::pow(x, 1 / (standard_air::gamma - 1));
+        else
+            return x * x * x * rsqrt<N_ITER>(x);
+    }
+
+    /*Validation of the fast kernels against the exact ones. Returns the lowest number of Newton iterations in
+    newton_iteration_levels for which all kernels are within the relative tolerance. Throws if there is none*/
+    ShortIndex select_newton_iterations(Scalar tolerance);
+}
@@ -3,6 +3,7 @@
 #include "Includes.hpp"
 #include "Utilities.hpp"
 #include "Config.hpp"
+#include "ThreadPool.hpp"
 
 namespace geom
 {
@@ -18,9 +19,14 @@ namespace geom
         Vector<Cell> cells;
         Vector<Face> faces;
         Vector<Patch> patches;
+        CellConnectivity cell_connectivity;
+        Vector<StorageVec3> least_squares_weights; // One weight vector per entry in cell_connectivity
+        KExactStencils kexact_stencils;
+
+        ThreadPool &thread_pool;
 
     public:
-        Grid(Config &config);
+        Grid(Config &config, ThreadPool &thread_pool);
 
         void print_grid(const Config &config) const;
         void print_native_mesh() const;
@@ -30,6 +36,9 @@ namespace geom
         const Vector<Cell> &get_cells() const { return cells; }
         const Vector<Face> &get_faces() const { return faces; }
         const Vector<Patch> &get_patches() const { return patches; }
+        const CellConnectivity &get_cell_connectivity() const { return cell_connectivity; }
+        const Vector<StorageVec3> &get_least_squares_weights() const { return least_squares_weights; }
+        const KExactStencils &get_kexact_stencils() const { return kexact_stencils; }
 
     private:
         /*Read mesh file. This populates the:
@@ -55,6 +64,15 @@ namespace geom
         // Reorders the (for now interior) faces in an optimal fashion based on the face indices
         void reorder_faces(const Config &config);
 
+        /*Creates the CSR cell to face adjacency from the (reordered) faces*/
+        void create_cell_connectivity(const Config &config);
+
+        /*Precomputes the weights of the inverse distance weighted least squares gradient*/
+        void calc_least_squares_weights(const Config &config);
+
+        /*Creates the stencils of the quadratic k-exact reconstruction and precomputes their weights*/
+        void calc_kexact_stencils(const Config &config);
+
         /*Assigns cell centers, boundary normals, etc*/
         void assign_geometry_properties(const Config &config, const Vector<Triangle> &face_triangles);
 
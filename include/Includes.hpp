@@ -16,6 +16,9 @@
 #include <cfloat>
 #include <type_traits>
 #include <filesystem>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
 
 using std::array;
 using std::cerr;
@@ -44,6 +47,18 @@ constexpr char Scalar_name[] = "double";
 
 using Vec3 = Eigen::Vector3<Scalar>;
 
+/*In mixed precision mode the fields that are read many times per flux evaluation (primitive variables, their
+gradients and limiters) and the face geometry are stored in single precision, halving the memory traffic of the
+face and cell sweeps. The conservative variables, the flux balance and the construction of the grid geometry are
+kept in Scalar, and all arithmetic is done in Scalar after loading the stored values.*/
+#ifdef USE_MIXED_PRECISION
+using StorageScalar = float;
+#else
+using StorageScalar = Scalar;
+#endif
+
+using StorageVec3 = Eigen::Vector3<StorageScalar>;
+
 inline string horizontal_string_Vec3(const Vec3 &v) { return "[" + std::to_string(v[0]) + ", " + std::to_string(v[1]) + ", " + std::to_string(v[2]) + " ]"; }
 
 constexpr ShortIndex N_DIM{3}; // spatial dimensions
@@ -61,6 +76,24 @@ using Seconds = std::chrono::seconds;
 using Milliseconds = std::chrono::milliseconds;
 using std::chrono::duration_cast;
 
+/*Accumulates the wall time of repeated calls to start() and stop(). Used for timing the phases of the solver*/
+class Stopwatch
+{
+    Time start_time;
+    double total_seconds{0.0};
+    size_t n_calls{0};
+
+public:
+    void start() { start_time = Clock::now(); }
+    void stop()
+    {
+        total_seconds += std::chrono::duration<double>(Clock::now() - start_time).count();
+        n_calls++;
+    }
+    double get_total_seconds() const { return total_seconds; }
+    size_t get_n_calls() const { return n_calls; }
+};
+
 /*Adding range checking to the [] operator for std::vector in debug mode (NDEBUG not defined)*/
 template <typename T>
 class Vector final : public std::vector<T>
@@ -116,7 +149,7 @@ inline bool is_approx_zero(Scalar val)
 template <typename T>
 inline bool num_is_valid(T val)
 {
-    static_assert(std::is_same<T, Scalar>());
+    static_assert(std::is_same<T, Scalar>() || std::is_same<T, StorageScalar>());
 
     if (std::isnan(val) || !std::isfinite(val))
         return false;
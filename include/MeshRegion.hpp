@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Includes.hpp"
+#include "Utilities.hpp"
+#include "Config.hpp"
+#include "ThreadPool.hpp"
+
+/*The gradient and limiter kernels loop over a region of the mesh, given as a template argument so that the loops
+over the whole mesh are resolved at compile time. A region provides for_cells, for_interior_faces and
+for_boundary_faces, calling f(i) / f(ij) for its cells and faces (in increasing order when run serially), and
+contains(i), telling if the values of interior cell i are to be updated by the faces of the region*/
+
+/*All interior cells and all faces. The cells are visited on the thread pool if given, the kernels only write to
+the cell passed to f in their cell loops. The faces, which scatter to both their cells, are visited serially*/
+struct WholeMesh
+{
+    Index N_INTERIOR_CELLS;
+    Index N_INTERIOR_FACES;
+    Index N_TOTAL_FACES;
+    ThreadPool *thread_pool;
+
+    explicit WholeMesh(const Config &config, ThreadPool *thread_pool = nullptr)
+        : N_INTERIOR_CELLS{config.get_N_INTERIOR_CELLS()},
+          N_INTERIOR_FACES{config.get_N_INTERIOR_FACES()},
+          N_TOTAL_FACES{config.get_N_TOTAL_FACES()},
+          thread_pool{thread_pool} {}
+
+    template <typename Function>
+    void for_cells(Function &&f) const
+    {
+        if (thread_pool)
+        {
+            thread_pool->parallel_for(0, N_INTERIOR_CELLS, f);
+            return;
+        }
+        for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+            f(i);
+    }
+
+    template <typename Function>
+    void for_interior_faces(Function &&f) const
+    {
+        for (Index ij{0}; ij < N_INTERIOR_FACES; ij++)
+            f(ij);
+    }
+
+    template <typename Function>
+    void for_boundary_faces(Function &&f) const
+    {
+        for (Index ij{N_INTERIOR_FACES}; ij < N_TOTAL_FACES; ij++)
+            f(ij);
+    }
+
+    static constexpr bool contains(Index) { return true; }
+};
+
+/*A block of cells (level 0) and the layers of neighbouring cells around it, where the cells of level l + 1 share a
+face with a cell of level l. The faces are those of the cells below the last level, each with the lowest level
+of its two cells. Used by the temporal blocking of the time integration, see Solver::create_cell_blocks*/
+struct CellBlock
+{
+    Vector<Index> cells;         // Ordered by level, the cells of level l are cells[level_offsets[l]] ... cells[level_offsets[l + 1] - 1]
+    Vector<Index> level_offsets;
+    Vector<Index> interior_faces; // In increasing order
+    Vector<ShortIndex> interior_face_levels;
+    Vector<Index> boundary_faces; // In increasing order
+    Vector<ShortIndex> boundary_face_levels;
+
+    ShortIndex n_levels() const { return level_offsets.size() - 1; }
+};
+
+/*The cells of a block up to max_level and the faces of these cells. cell_levels holds the level of all interior
+cells in the block being processed and NOT_IN_BLOCK for the others*/
+struct BlockRegion
+{
+    static constexpr ShortIndex NOT_IN_BLOCK = std::numeric_limits<ShortIndex>::max();
+
+    const CellBlock &block;
+    const Vector<ShortIndex> &cell_levels;
+    ShortIndex max_level;
+
+    template <typename Function>
+    void for_cells(Function &&f) const
+    {
+        assert(max_level < block.n_levels());
+        for (Index c{0}; c < block.level_offsets[max_level + 1]; c++)
+            f(block.cells[c]);
+    }
+
+    template <typename Function>
+    void for_interior_faces(Function &&f) const
+    {
+        for (Index k{0}; k < block.interior_faces.size(); k++)
+            if (block.interior_face_levels[k] <= max_level)
+                f(block.interior_faces[k]);
+    }
+
+    template <typename Function>
+    void for_boundary_faces(Function &&f) const
+    {
+        for (Index k{0}; k < block.boundary_faces.size(); k++)
+            if (block.boundary_face_levels[k] <= max_level)
+                f(block.boundary_faces[k]);
+    }
+
+    bool contains(Index i) const { return cell_levels[i] <= max_level; }
+};
@@ -3,23 +3,116 @@
 #include "Utilities.hpp"
 #include "Grid.hpp"
 #include "SolverData.hpp"
+#include "MeshRegion.hpp"
 
 class NumericalFlux
 {
 public:
-    using InvFluxFunction = std::function<void(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux)>;
+    /*The flux scheme is a template parameter so that the solver pipelines can inline the flux function.
+    The flux functions return the largest convective spectral radius |v_n| + c at the face, used for the time step.
+    math_iterations selects the fast math kernels of the Rusanov flux, see FastMath.hpp*/
+    template <InviscidFluxScheme INV_FLUX_SCHEME>
+    static Scalar calc_inviscid_flux(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux,
+                                     ShortIndex math_iterations = 0)
+    {
+        if constexpr (INV_FLUX_SCHEME == InviscidFluxScheme::Rusanov)
+        {
+            switch (math_iterations)
+            {
+            case 2:
+                return rusanov<2>(U_L, U_R, S_ij, Flux);
+            case 3:
+                return rusanov<3>(U_L, U_R, S_ij, Flux);
+            default:
+                assert(math_iterations == 0);
+                return rusanov<0>(U_L, U_R, S_ij, Flux);
+            }
+        }
+        else
+        {
+            static_assert(INV_FLUX_SCHEME == InviscidFluxScheme::HLLC);
+            return HLLC(U_L, U_R, S_ij, Flux);
+        }
+    }
 
-    static InvFluxFunction get_inviscid_flux_function(InviscidFluxScheme inv_flux_scheme);
+    /*Viscous flux of a gas of constant viscosity through the face S_ij between cells i and j, with primitive
+    variables V_i and V_j, gradients grad_i and grad_j, and the centroid of j at d_ij from that of i. The face
+    gradient is the mean of the cell gradients with its component along d_ij replaced by the difference of the
+    cell values. The heat flux is taken from the gradient of p / rho, heat_conduction being the conductivity
+    divided by the gas constant. Returns the viscous spectral radius viscosity / (rho * |d_ij|) of the face*/
+    static Scalar calc_viscous_flux(const EulerVec &V_i, const EulerVec &V_j, const EulerGrad &grad_i, const EulerGrad &grad_j,
+                                    const Vec3 &d_ij, const Vec3 &S_ij, Scalar viscosity, Scalar heat_conduction, EulerVec &Flux);
 
 private:
-    static void rusanov(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux);
-
-    static void HLLC(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux);
+    template <ShortIndex MATH_ITER>
+    static Scalar rusanov(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux);
 
-    static inline const map<InviscidFluxScheme, InvFluxFunction> inv_flux_functions = {{InviscidFluxScheme::Rusanov, rusanov},
-                                                                                       {InviscidFluxScheme::HLLC, HLLC}};
+    static Scalar HLLC(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux);
 };
 
+template <ShortIndex MATH_ITER>
+inline Scalar NumericalFlux::rusanov(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux)
+{
+    Vec3 normal;
+    Scalar area;
+    if constexpr (MATH_ITER == 0)
+    {
+        normal = S_ij.normalized();
+        area = S_ij.norm();
+    }
+    else
+    {
+        const Scalar area_sq = S_ij.squaredNorm();
+        const Scalar inv_area = fast_math::rsqrt<MATH_ITER>(area_sq);
+        normal = inv_area * S_ij;
+        area = area_sq * inv_area;
+    }
+    Scalar spec_rad_L = EulerEqs::conv_spectral_radii<MATH_ITER>(U_L, normal);
+    Scalar spec_rad_R = EulerEqs::conv_spectral_radii<MATH_ITER>(U_R, normal);
+    Scalar spec_rad = std::max(spec_rad_R, spec_rad_L);
+
+    Flux = area * 0.5 * (EulerEqs::inviscid_flux(U_R, normal) + EulerEqs::inviscid_flux(U_L, normal) - spec_rad * (U_R - U_L));
+    return spec_rad;
+}
+
+inline Scalar NumericalFlux::calc_viscous_flux(const EulerVec &V_i, const EulerVec &V_j, const EulerGrad &grad_i, const EulerGrad &grad_j,
+                                               const Vec3 &d_ij, const Vec3 &S_ij, Scalar viscosity, Scalar heat_conduction, EulerVec &Flux)
+{
+    using ViscousVec = Eigen::Vector<Scalar, N_DIM + 1>;
+    using ViscousGrad = Eigen::Matrix<Scalar, N_DIM + 1, N_DIM>;
+    using Mat3 = Eigen::Matrix3<Scalar>;
+
+    /*Velocity components and p / rho, with their gradients*/
+    auto viscous_variables = [](const EulerVec &V, const EulerGrad &grad, ViscousVec &W, ViscousGrad &W_grad)
+    {
+        W.head<N_DIM>() = V.segment<N_DIM>(1);
+        W[N_DIM] = V[4] / V[0];
+        W_grad.topRows<N_DIM>() = grad.middleRows<N_DIM>(1);
+        W_grad.row(N_DIM) = (grad.row(4) - W[N_DIM] * grad.row(0)) / V[0];
+    };
+
+    ViscousVec W_i, W_j;
+    ViscousGrad W_grad_i, W_grad_j;
+    viscous_variables(V_i, grad_i, W_i, W_grad_i);
+    viscous_variables(V_j, grad_j, W_j, W_grad_j);
+
+    const Scalar distance = d_ij.norm();
+    const Vec3 e_ij = d_ij / distance;
+    const ViscousGrad W_grad_mean = 0.5 * (W_grad_i + W_grad_j);
+    const ViscousGrad W_grad = W_grad_mean + ((W_j - W_i) / distance - W_grad_mean * e_ij) * e_ij.transpose();
+
+    const Mat3 vel_grad = W_grad.topRows<N_DIM>();
+    const Mat3 stress = viscosity * (vel_grad + vel_grad.transpose() - 2.0 / 3.0 * vel_grad.trace() * Mat3::Identity());
+    const Vec3 stress_S = stress * S_ij;
+    const Vec3 vel_face = 0.5 * (W_i.head<N_DIM>() + W_j.head<N_DIM>());
+
+    Flux[0] = 0.0;
+    Flux.segment<N_DIM>(1) = stress_S;
+    Flux[4] = vel_face.dot(stress_S) + heat_conduction * W_grad.row(N_DIM).dot(S_ij);
+
+    return viscosity / (0.5 * (V_i[0] + V_j[0]) * distance);
+}
+
 // class BoundaryCondition
 // {
 // public:
@@ -39,95 +132,285 @@ private:
 //                                                                        {BoundaryType::FarField, farfield}};
 // };
 
+/*The boundary conditions hold no state that changes between calls, so one object can be used by several
+threads at the same time*/
 class BoundaryCondition
 {
 
 public:
-    virtual void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) = 0;
+    virtual void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const = 0;
 };
 
 class BC_NoSlipWall : public BoundaryCondition
 {
 public:
-    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) final;
+    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const final;
 };
 
 class BC_SlipWall : public BoundaryCondition
 {
-    Vec3 normal;
-    Scalar vel_normal;
-
 public:
-    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) final;
+    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const final;
 };
 
 class BC_FarField : public BoundaryCondition
 {
-    Scalar c_domain, c_fs, c_boundary;
-    Scalar entropy_fs, entropy_domain, entropy_boundary;
-    Scalar density_fs, density_boundary;
-    Vec3 vel_domain, vel_fs, vel_boundary;
-    Scalar pressure_fs, pressure_boundary;
-    Vec3 normal;
-    Scalar vel_n_domain, vel_n_fs, vel_n_boundary;
-    Scalar Riemann_plus, Riemann_minus;
+    Scalar c_fs;
+    Scalar entropy_fs;
+    Scalar density_fs;
+    Vec3 vel_fs;
+    Scalar pressure_fs;
+
+    ShortIndex math_iterations; // Newton iterations of the fast math kernels, 0 = exact
+
+    template <ShortIndex MATH_ITER>
+    void calc_ghost_val_kernels(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const;
 
 public:
     BC_FarField(const Config &config);
-    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) final;
+    void calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const final;
 };
 
+/*The gradient and limiter kernels take the values outside the boundary faces from boundary_value(ij, V_i),
+where ij is the boundary face and V_i the value of its domain cell. This way the kernels work both with
+and without stored ghost cells, see EulerSolver::calc_boundary_primvars. They are restricted to the cells of
+region, see MeshRegion.hpp*/
+
+/*Value of the neighbour in entry k of the cell connectivity of cell i, V_i being the value of cell i*/
+template <ShortIndex N_EQS, typename BoundaryValue>
+inline Eigen::Vector<Scalar, N_EQS> calc_neighbour_value(const geom::CellConnectivity &cell_connectivity,
+                                                         const StorageVecField &vec_field,
+                                                         Index k,
+                                                         const Eigen::Vector<Scalar, N_EQS> &V_i,
+                                                         Index N_INTERIOR_CELLS,
+                                                         BoundaryValue &&boundary_value)
+{
+    const Index j = cell_connectivity.neighbours[k];
+    if (j < N_INTERIOR_CELLS)
+        return vec_field.get_variable<Eigen::Vector<StorageScalar, N_EQS>>(j).template cast<Scalar>();
+    else
+        return boundary_value(cell_connectivity.face_indices[k], V_i);
+}
+
 namespace Gradient
 {
     using namespace geom;
 
     /*Implementing the "compact" gradient in the cell center, from chapter 9.2 in Moukalled et. al. No orthogonal correction for now*/
 
-    template <ShortIndex N_EQS>
+    template <ShortIndex N_EQS, typename Region, typename BoundaryValue>
     inline void calc_green_gauss_gradient(const Config &config,
                                           const Grid &grid,
-                                          const VecField &vec_field,
-                                          GradField &grad_field)
+                                          const StorageVecField &vec_field,
+                                          GradField &grad_field,
+                                          const Region &region,
+                                          BoundaryValue &&boundary_value)
     {
 
         assert(grad_field.cols() == N_DIM && grad_field.rows() == N_EQS && vec_field.rows() == N_EQS);
-        assert(grad_field.size() == config.get_N_INTERIOR_CELLS() && vec_field.size() == config.get_N_TOTAL_CELLS());
+        assert(grad_field.size() == config.get_N_INTERIOR_CELLS() && vec_field.size() >= config.get_N_INTERIOR_CELLS());
 
         using FieldVec = Eigen::Vector<Scalar, N_EQS>;
         using FieldGrad = Eigen::Matrix<Scalar, N_EQS, N_DIM>;
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
 
         const auto &faces = grid.get_faces();
         const auto &cells = grid.get_cells();
 
-        const Index N_FACES = config.get_N_TOTAL_FACES();
-        const Index N_CELLS = config.get_N_INTERIOR_CELLS();
+        FieldVec U_face;
+        FieldGrad tmp;
 
-        Index i, j;
+        region.for_cells([&](Index i)
+                         { grad_field.get_variable<StorageFieldGrad>(i).setZero(); });
+
+        region.for_interior_faces([&](Index ij)
+                                  {
+            const Face &face = faces[ij];
+            const Index i = face.i;
+            const Index j = face.j;
+
+            // Simple average for now, might improve later with distance weighting and orthogonal correctors later
+            U_face = 0.5 * (vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>() +
+                            vec_field.get_variable<StorageFieldVec>(j).template cast<Scalar>());
+
+            tmp = U_face * face.S_ij.cast<Scalar>().transpose(); // DOES THIS MAKE SENSE?? (ij)
+
+            if (region.contains(i))
+                grad_field.get_variable<StorageFieldGrad>(i) += (tmp / cells[i].cell_volume).template cast<StorageScalar>();
+            if (region.contains(j))
+                grad_field.get_variable<StorageFieldGrad>(j) -= (tmp / cells[j].cell_volume).template cast<StorageScalar>(); });
+
+        region.for_boundary_faces([&](Index ij)
+                                  {
+            const Face &face = faces[ij];
+            const Index i = face.i;
+
+            const FieldVec V_i = vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+            U_face = 0.5 * (V_i + boundary_value(ij, V_i));
+
+            tmp = U_face * face.S_ij.cast<Scalar>().transpose();
+
+            grad_field.get_variable<StorageFieldGrad>(i) += (tmp / cells[i].cell_volume).template cast<StorageScalar>(); });
+    }
+
+    /*Green-Gauss gradient of cell i alone, summed over the faces of the cell instead of scattered from the faces.
+    The faces are added in the same order and with the same operations as in calc_green_gauss_gradient, so the
+    result is the same*/
+    template <ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_green_gauss_cell_gradient(Index i,
+                                               const Grid &grid,
+                                               const StorageVecField &vec_field,
+                                               GradField &grad_field,
+                                               Index N_INTERIOR_CELLS,
+                                               BoundaryValue &&boundary_value)
+    {
+        using FieldVec = Eigen::Vector<Scalar, N_EQS>;
+        using FieldGrad = Eigen::Matrix<Scalar, N_EQS, N_DIM>;
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
+
+        const auto &faces = grid.get_faces();
+        const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+        const Scalar cell_volume = grid.get_cells()[i].cell_volume;
 
         FieldVec U_face;
         FieldGrad tmp;
 
-        grad_field.set_zero();
+        auto grad_i = grad_field.get_variable<StorageFieldGrad>(i);
+        grad_i.setZero();
 
-        for (Index ij{0}; ij < N_FACES; ij++)
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
         {
+            const Index ij = cell_connectivity.face_indices[k];
             const Face &face = faces[ij];
-            i = face.i;
-            j = face.j;
 
-            const Cell &cell_i = cells[i];
-            const Cell &cell_j = cells[j];
+            if (cell_connectivity.neighbours[k] < N_INTERIOR_CELLS)
+            {
+                U_face = 0.5 * (vec_field.get_variable<StorageFieldVec>(face.i).template cast<Scalar>() +
+                                vec_field.get_variable<StorageFieldVec>(face.j).template cast<Scalar>());
 
-            // Simple average for now, might improve later with distance weighting and orthogonal correctors later
-            U_face = 0.5 * (vec_field.get_variable<FieldVec>(i) + vec_field.get_variable<FieldVec>(j));
+                tmp = U_face * face.S_ij.cast<Scalar>().transpose();
+
+                if (face.i == i)
+                    grad_i += (tmp / cell_volume).template cast<StorageScalar>();
+                else
+                    grad_i -= (tmp / cell_volume).template cast<StorageScalar>();
+            }
+            else
+            {
+                const FieldVec V_i = vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+                U_face = 0.5 * (V_i + boundary_value(ij, V_i));
 
-            tmp = U_face * face.S_ij.transpose(); // DOES THIS MAKE SENSE?? (ij)
+                tmp = U_face * face.S_ij.cast<Scalar>().transpose();
 
-            grad_field.get_variable<FieldGrad>(i) += tmp / cell_i.cell_volume;
-            if (j < N_CELLS) // only calculate gradient for interior cells?
-                grad_field.get_variable<FieldGrad>(j) -= tmp / cell_j.cell_volume;
+                grad_i += (tmp / cell_volume).template cast<StorageScalar>();
+            }
         }
     }
+
+    /*Green-Gauss gradient of all interior cells with the faces distributed over the thread pool. The face
+    contributions are added to the cells with atomic updates, so the order of the additions, and thereby the
+    rounding, depends on the schedule of the threads*/
+    template <ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_green_gauss_gradient_atomic(const Config &config,
+                                                 const Grid &grid,
+                                                 const StorageVecField &vec_field,
+                                                 GradField &grad_field,
+                                                 ThreadPool &thread_pool,
+                                                 BoundaryValue &&boundary_value)
+    {
+        assert(grad_field.cols() == N_DIM && grad_field.rows() == N_EQS && vec_field.rows() == N_EQS);
+        assert(grad_field.size() == config.get_N_INTERIOR_CELLS() && vec_field.size() >= config.get_N_INTERIOR_CELLS());
+
+        using FieldVec = Eigen::Vector<Scalar, N_EQS>;
+        using FieldGrad = Eigen::Matrix<Scalar, N_EQS, N_DIM>;
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
+
+        const auto &faces = grid.get_faces();
+        const auto &cells = grid.get_cells();
+        const Index N_INTERIOR_FACES = config.get_N_INTERIOR_FACES();
+
+        thread_pool.parallel_for(0, config.get_N_INTERIOR_CELLS(), [&](Index i)
+                                 { grad_field.get_variable<StorageFieldGrad>(i).setZero(); });
+
+        auto add_atomic = [&](Index i, const StorageFieldGrad &grad)
+        {
+            for (ShortIndex k{0}; k < N_EQS; k++)
+                for (ShortIndex l{0}; l < N_DIM; l++)
+                {
+                    StorageScalar &grad_i = grad_field(i, k, l);
+#pragma omp atomic
+                    grad_i += grad(k, l);
+                }
+        };
+
+        thread_pool.parallel_for(0, config.get_N_TOTAL_FACES(), [&](Index ij)
+                                 {
+            const Face &face = faces[ij];
+            const Index i = face.i;
+            const FieldVec V_i = vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+
+            FieldVec U_face;
+            if (ij < N_INTERIOR_FACES)
+                U_face = 0.5 * (V_i + vec_field.get_variable<StorageFieldVec>(face.j).template cast<Scalar>());
+            else
+                U_face = 0.5 * (V_i + boundary_value(ij, V_i));
+
+            const FieldGrad tmp = U_face * face.S_ij.cast<Scalar>().transpose();
+
+            add_atomic(i, (tmp / cells[i].cell_volume).template cast<StorageScalar>());
+            if (ij < N_INTERIOR_FACES)
+                add_atomic(face.j, (-tmp / cells[face.j].cell_volume).template cast<StorageScalar>()); });
+    }
+
+    /*Least squares gradient of cell i alone*/
+    template <ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_least_squares_cell_gradient(Index i,
+                                                 const Grid &grid,
+                                                 const StorageVecField &vec_field,
+                                                 GradField &grad_field,
+                                                 Index N_INTERIOR_CELLS,
+                                                 BoundaryValue &&boundary_value)
+    {
+        using FieldVec = Eigen::Vector<Scalar, N_EQS>;
+        using FieldGrad = Eigen::Matrix<Scalar, N_EQS, N_DIM>;
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
+
+        const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+        const Vector<StorageVec3> &weights = grid.get_least_squares_weights();
+
+        const FieldVec V_i = vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+
+        FieldGrad grad_i = FieldGrad::Zero();
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            grad_i += (calc_neighbour_value<N_EQS>(cell_connectivity, vec_field, k, V_i, N_INTERIOR_CELLS, boundary_value) - V_i) *
+                      weights[k].cast<Scalar>().transpose();
+
+        grad_field.get_variable<StorageFieldGrad>(i) = grad_i.template cast<StorageScalar>();
+    }
+
+    /*Weighted least squares gradient, using the weights precomputed by the grid. See Grid::calc_least_squares_weights*/
+    template <ShortIndex N_EQS, typename Region, typename BoundaryValue>
+    inline void calc_least_squares_gradient(const Config &config,
+                                            const Grid &grid,
+                                            const StorageVecField &vec_field,
+                                            GradField &grad_field,
+                                            const Region &region,
+                                            BoundaryValue &&boundary_value)
+    {
+        assert(grad_field.cols() == N_DIM && grad_field.rows() == N_EQS && vec_field.rows() == N_EQS);
+        assert(grad_field.size() == config.get_N_INTERIOR_CELLS() && vec_field.size() >= config.get_N_INTERIOR_CELLS());
+
+        assert(grid.get_least_squares_weights().size() == grid.get_cell_connectivity().neighbours.size());
+
+        const Index N_CELLS = config.get_N_INTERIOR_CELLS();
+
+        region.for_cells([&](Index i)
+                         { calc_least_squares_cell_gradient<N_EQS>(i, grid, vec_field, grad_field, N_CELLS, boundary_value); });
+    }
 }
 
 namespace Reconstruction
@@ -151,6 +434,7 @@ namespace Reconstruction
     //         V_f[k] = V_c[k] + limiter_c[k] * Delta_V[k];
     //     }
     // }
+    /*The cell values may be stored in StorageScalar, the reconstruction itself is done in Scalar*/
     template <typename VecMapType, typename GradMapType, typename VecType>
     inline void calc_limited_reconstruction(
         const VecMapType &V_c,
@@ -160,83 +444,176 @@ namespace Reconstruction
         VecType &V_f)
     {
         // perhaps some static assersions here
-        V_f = limiter_c.cwiseProduct(V_c_grad * r_cf); // not finished
+        V_f = V_c.template cast<Scalar>() +
+              limiter_c.template cast<Scalar>().cwiseProduct(V_c_grad.template cast<Scalar>() * r_cf);
     }
 
-    /*Implementing the Barth limiter procedure in Blazek*/
-    template <ShortIndex N_EQS>
-    inline void calc_barth_limiter(const Config &config,
-                                   const Grid &grid,
-                                   const VecField &sol_field,
-                                   const GradField &sol_grad,
-                                   const VecField &max_field,
-                                   const VecField &min_field,
-                                   VecField &limiter)
+    template <typename VecMapType, typename GradMapType, typename VecType>
+    inline void calc_unlimited_reconstruction(
+        const VecMapType &V_c,
+        const GradMapType &V_c_grad,
+        const Vec3 &r_cf,
+        VecType &V_f)
     {
+        V_f = V_c.template cast<Scalar>() + V_c_grad.template cast<Scalar>() * r_cf;
+    }
 
-        assert(N_EQS == sol_field.get_N_EQS() && N_EQS == sol_grad.get_N_EQS() && N_EQS == max_field.get_N_EQS() &&
-               N_EQS == min_field.get_N_EQS() && N_EQS == limiter.get_N_EQS());
+    /*Quadratic reconstruction V_f = V_c + grad * r_cf + hessian * (m(r_cf) - m_c), m being quadratic_monomials and
+    m_c the moments of the cell, see Grid::calc_kexact_stencils*/
+    template <typename VecMapType, typename GradMapType, typename HessianMapType, typename MomentsType, typename VecType>
+    inline void calc_quadratic_reconstruction(
+        const VecMapType &V_c,
+        const GradMapType &V_c_grad,
+        const HessianMapType &V_c_hessian,
+        const MomentsType &moments_c,
+        const Vec3 &r_cf,
+        VecType &V_f)
+    {
+        V_f = V_c.template cast<Scalar>() + V_c_grad.template cast<Scalar>() * r_cf +
+              V_c_hessian.template cast<Scalar>() * (quadratic_monomials(r_cf) - moments_c.template cast<Scalar>());
+    }
 
-        const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
-        const Index N_TOTAL_FACES = config.get_N_TOTAL_FACES();
+    /*Gradient and Hessian of the quadratic k-exact reconstruction of cell i, from the values of its stencil and the
+    precomputed weights, see Grid::calc_kexact_stencils. The face neighbours come first, in the order of the cell
+    connectivity, so that the ghost cells are found as in the other kernels*/
+    template <ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_kexact_cell_fit(Index i,
+                                     const Grid &grid,
+                                     const StorageVecField &vec_field,
+                                     GradField &grad_field,
+                                     HessianField &hessian_field,
+                                     Index N_INTERIOR_CELLS,
+                                     BoundaryValue &&boundary_value)
+    {
+        using FieldVec = Eigen::Vector<Scalar, N_EQS>;
+        using FieldCoeffs = Eigen::Matrix<Scalar, N_EQS, N_KEXACT_COEFFS>;
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
+        using StorageFieldHessian = Eigen::Matrix<StorageScalar, N_EQS, N_HESSIAN>;
+
+        const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+        const KExactStencils &stencils = grid.get_kexact_stencils();
+        const KExactWeights *weights = stencils.weights.data() + stencils.begin_weights(i, cell_connectivity);
+
+        const FieldVec V_i = vec_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+
+        FieldCoeffs coeffs = FieldCoeffs::Zero();
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            coeffs += (calc_neighbour_value<N_EQS>(cell_connectivity, vec_field, k, V_i, N_INTERIOR_CELLS, boundary_value) - V_i) *
+                      (weights++)->template cast<Scalar>().transpose();
+        for (Index s{stencils.offsets[i]}; s < stencils.offsets[i + 1]; s++)
+            coeffs += (vec_field.get_variable<StorageFieldVec>(stencils.outer_cells[s]).template cast<Scalar>() - V_i) *
+                      (weights++)->template cast<Scalar>().transpose();
+
+        grad_field.get_variable<StorageFieldGrad>(i) = coeffs.template leftCols<N_DIM>().template cast<StorageScalar>();
+        hessian_field.get_variable<StorageFieldHessian>(i) = coeffs.template rightCols<N_HESSIAN>().template cast<StorageScalar>();
+    }
+
+    /*Limiter value from a single face of a cell, following Blazek. Delta_1_max = U_max - U_i and
+    Delta_1_min = U_min - U_i are the neighbour bounds, Delta_2 is the unlimited increment from the
+    cell center to the face and eps2 is the smoothing parameter of the Venkatakrishnan limiter*/
+    template <Limiter LIMITER>
+    inline Scalar calc_face_limiter_value(Scalar Delta_1_max, Scalar Delta_1_min, Scalar Delta_2, Scalar eps2)
+    {
+        constexpr Scalar EPS = std::numeric_limits<Scalar>::epsilon();
+
+        if (Delta_2 == 0.0)
+            return 1.0;
 
-        assert(sol_field.size() == config.get_N_TOTAL_CELLS() && sol_grad.size() == N_INTERIOR_CELLS && max_field.size() == N_INTERIOR_CELLS &&
-               min_field.size() == N_INTERIOR_CELLS && limiter.size() == N_INTERIOR_CELLS);
+        // EPS added to avoid division by zero
+        Delta_2 = (Delta_2 > 0.0) ? Delta_2 + EPS : Delta_2 - EPS;
+        const Scalar Delta_1 = (Delta_2 > 0.0) ? Delta_1_max : Delta_1_min;
 
+        if constexpr (LIMITER == Limiter::Barth)
+        {
+            return min(1.0, Delta_1 / Delta_2);
+        }
+        else
+        {
+            static_assert(LIMITER == Limiter::Venkatakrishnan);
+            const Scalar Delta_1_sq = Delta_1 * Delta_1;
+            const Scalar Delta_2_sq = Delta_2 * Delta_2;
+            return ((Delta_1_sq + eps2) * Delta_2 + 2 * Delta_2_sq * Delta_1) /
+                   (Delta_2 * (Delta_1_sq + 2 * Delta_2_sq + Delta_1 * Delta_2 + eps2));
+        }
+    }
+
+    /*Implementing the Barth and Venkatakrishnan limiter procedures in Blazek for cell i. The neighbour bounds
+    U_max = max(U_i, max_j(U_j)) and U_min = min(U_i, min_j(U_j)) are gathered from the CSR adjacency and used right
+    away, so the bounds and the limiter are computed in a single sweep without storing the bounds.
+    The Venkatakrishnan smoothing parameter is scaled with the mesh as eps^2 = (K * h)^3 = K^3 * Omega_i*/
+    template <Limiter LIMITER, ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_cell_limiter(Index i,
+                                  const Grid &grid,
+                                  const StorageVecField &sol_field,
+                                  const GradField &sol_grad,
+                                  StorageVecField &limiter,
+                                  Scalar K_cubed,
+                                  BoundaryValue &&boundary_value)
+    {
         using FieldVec = Eigen::Vector<Scalar, N_EQS>;
         using FieldGrad = Eigen::Matrix<Scalar, N_EQS, N_DIM>;
-        using FieldGradMap = Eigen::Map<FieldGrad>;
-
-        constexpr Scalar EPS = std::numeric_limits<Scalar>::epsilon();
+        using StorageFieldVec = Eigen::Vector<StorageScalar, N_EQS>;
+        using StorageFieldGrad = Eigen::Matrix<StorageScalar, N_EQS, N_DIM>;
 
         const auto &faces = grid.get_faces();
+        const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+        const Index N_INTERIOR_CELLS = limiter.size();
 
-        FieldVec Delta_2;
-        FieldGrad gradient;
+        const FieldVec V_i = sol_field.get_variable<StorageFieldVec>(i).template cast<Scalar>();
+        const FieldGrad gradient_i = sol_grad.get_variable<StorageFieldGrad>(i).template cast<Scalar>();
+        FieldVec limiter_i;
+
+        FieldVec V_max = V_i;
+        FieldVec V_min = V_i;
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+        {
+            const FieldVec V_j = calc_neighbour_value<N_EQS>(cell_connectivity, sol_field, k, V_i, N_INTERIOR_CELLS, boundary_value);
+            V_max = V_max.cwiseMax(V_j);
+            V_min = V_min.cwiseMin(V_j);
+        }
+        V_max -= V_i;
+        V_min -= V_i;
 
-        limiter = DBL_MAX;
+        Scalar eps2{0.0};
+        if constexpr (LIMITER == Limiter::Venkatakrishnan)
+            eps2 = K_cubed * grid.get_cells()[i].cell_volume;
 
-        for (Index ij{0}; ij < N_TOTAL_FACES; ij++)
+        FieldVec Delta_2;
+        limiter_i.setOnes();
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
         {
-            const Face &face = faces[ij];
-            Index i = face.i;
-            Index j = face.j;
+            const Face &face = faces[cell_connectivity.face_indices[k]];
+            const Vec3 r_cf = ((face.i == i) ? face.r_im : face.r_jm).cast<Scalar>();
 
-            const FieldGradMap gradient_i = sol_grad.get_variable<FieldGrad>(i);
-            Delta_2 = gradient_i * face.r_im;
+            Delta_2 = gradient_i * r_cf;
 
-            for (ShortIndex k{0}; k < N_EQS; k++)
-            {
-                // to avoid division by zero
-                Delta_2[k] = sign(Delta_2[k]) * (abs(Delta_2[k]) + EPS);
+            for (ShortIndex l{0}; l < N_EQS; l++)
+                limiter_i[l] = min(limiter_i[l], calc_face_limiter_value<LIMITER>(V_max[l], V_min[l], Delta_2[l], eps2));
+        }
+        limiter.get_variable<StorageFieldVec>(i) = limiter_i.template cast<StorageScalar>();
+    }
 
-                if (Delta_2[k] > 0.0)
-                    limiter(i, k) = min(limiter(i, k), min(1.0, (max_field(i, k) - sol_field(i, k)) / Delta_2[k]));
-                else if (Delta_2[k] < 0.0)
-                    limiter(i, k) = min(limiter(i, k), min(1.0, (min_field(i, k) - sol_field(i, k)) / Delta_2[k]));
-                else
-                    limiter(i, k) = min(limiter(i, k), 1.0);
-            }
+    /*Calculates the limiter of all cells in region*/
+    template <Limiter LIMITER, ShortIndex N_EQS, typename Region, typename BoundaryValue>
+    inline void calc_limiter(const Config &config,
+                             const Grid &grid,
+                             const StorageVecField &sol_field,
+                             const GradField &sol_grad,
+                             StorageVecField &limiter,
+                             const Region &region,
+                             BoundaryValue &&boundary_value)
+    {
 
-            if (j < N_INTERIOR_CELLS)
-            {
-                const FieldGradMap &gradient_j = sol_grad.get_variable<FieldGrad>(j);
-                Delta_2 = gradient_j * face.r_jm;
+        assert(N_EQS == sol_field.get_N_EQS() && N_EQS == sol_grad.get_N_EQS() && N_EQS == limiter.get_N_EQS());
 
-                for (ShortIndex k{0}; k < N_EQS; k++)
-                {
-                    // to avoid division by zero
-                    Delta_2[k] = sign(Delta_2[k]) * (abs(Delta_2[k]) + EPS);
-
-                    if (Delta_2[k] > 0.0)
-                        limiter(j, k) = min(limiter(j, k), min(1.0, (max_field(j, k) - sol_field(j, k)) / Delta_2[k]));
-                    else if (Delta_2[k] < 0.0)
-                        limiter(j, k) = min(limiter(j, k), min(1.0, (min_field(j, k) - sol_field(j, k)) / Delta_2[k]));
-                    else
-                        limiter(j, k) = min(limiter(j, k), 1.0);
-                }
-            }
-        }
+        assert(sol_field.size() >= config.get_N_INTERIOR_CELLS() && sol_grad.size() == config.get_N_INTERIOR_CELLS() &&
+               limiter.size() == config.get_N_INTERIOR_CELLS());
+
+        const Scalar K = config.get_venkatakrishnan_K();
+
+        region.for_cells([&](Index i)
+                         { calc_cell_limiter<LIMITER, N_EQS>(i, grid, sol_field, sol_grad, limiter, K * K * K, boundary_value); });
 
 #ifndef NDEBUG
         /*Checking that the values lay between 0 and 1*/
@@ -250,50 +627,89 @@ namespace Reconstruction
 #endif
     }
 
-    /*Used in calculation of limiters*/
-    template <ShortIndex N_EQS>
-    void calc_max_and_min_values(const Config &config,
-                                 const Grid &grid,
-                                 const VecField &sol_field,
-                                 VecField &max_field,
-                                 VecField &min_field)
+    /*Calculates the limiter of the listed cells only, distributed over the thread pool. The limiter of the other
+    cells is left untouched*/
+    template <Limiter LIMITER, ShortIndex N_EQS, typename BoundaryValue>
+    inline void calc_limiter(const Config &config,
+                             const Grid &grid,
+                             const StorageVecField &sol_field,
+                             const GradField &sol_grad,
+                             StorageVecField &limiter,
+                             const Vector<Index> &limited_cells,
+                             ThreadPool &thread_pool,
+                             BoundaryValue &&boundary_value)
     {
+        assert(N_EQS == sol_field.get_N_EQS() && N_EQS == sol_grad.get_N_EQS() && N_EQS == limiter.get_N_EQS());
 
-        const Index N_TOTAL_FACES = config.get_N_TOTAL_FACES();
-        const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
-        assert(N_EQS == sol_field.get_N_EQS() && N_EQS == max_field.get_N_EQS() && N_EQS == min_field.get_N_EQS());
-        assert(sol_field.size() == config.get_N_TOTAL_CELLS() && max_field.size() == N_INTERIOR_CELLS && min_field.size() == N_INTERIOR_CELLS);
-
-        /*Setting the max and min fields to either a very large or a very small value*/
-        max_field = -DBL_MAX;
-        min_field = DBL_MAX;
-
-        const auto &faces = grid.get_faces();
+        const Scalar K = config.get_venkatakrishnan_K();
 
-        Index i, j;
+        thread_pool.parallel_for(0, limited_cells.size(), [&](Index n)
+                                 {
+            const Index i = limited_cells[n];
+            assert(i < config.get_N_INTERIOR_CELLS());
+            calc_cell_limiter<LIMITER, N_EQS>(i, grid, sol_field, sol_grad, limiter, K * K * K, boundary_value); });
+    }
 
-        /*the formulas to be computed are
-        U_max = max(U_i, max_j(U_j)) and U_min = min(U_i, min_j(U_j))
-        Looping over all edges instead of cells due to efficiency*/
+    /*Finds the cells that need limiting with the pressure based shock sensor of Jameson,
+    nu_i = |sum_j (p_j - p_i)| / sum_j (p_j + p_i). Cells where nu_i exceeds the threshold are marked together with
+    their interior neighbours, since these reconstruct towards the shock as well. The marked cells are returned in
+    increasing order in limited_cells. cell_marker is scratch space that has to be zero on entry, and is zero on exit.
+    The sensor is evaluated in a first pass over the thread pool, and the cells with a flagged cell among themselves
+    and their neighbours are gathered per chunk in a second pass, so that no cell is written by two threads*/
+    template <typename BoundaryValue>
+    inline void find_limited_cells(const Config &config,
+                                   const Grid &grid,
+                                   const StorageVecField &primvars,
+                                   Vector<Index> &limited_cells,
+                                   Vector<uint8_t> &cell_marker,
+                                   ThreadPool &thread_pool,
+                                   BoundaryValue &&boundary_value)
+    {
+        const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+        const Scalar threshold = config.get_shock_sensor_threshold();
+        const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+        constexpr ShortIndex P = primvars_index::Pressure;
 
-        for (Index ij{0}; ij < N_TOTAL_FACES; ij++)
-        {
-            const Face &face = faces[ij];
-            i = face.i;
-            j = face.j;
+        assert(cell_marker.size() == N_INTERIOR_CELLS);
 
-            for (ShortIndex k{0}; k < N_EQS; k++)
+        thread_pool.parallel_for(0, N_INTERIOR_CELLS, [&](Index i)
+                                 {
+            const Scalar p_i = primvars(i, P);
+            Scalar p_diff_sum{0.0}, p_sum{0.0};
+            for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
             {
-                max_field(i, k) = std::max(max_field(i, k), sol_field(i, k));
-                max_field(i, k) = std::max(max_field(i, k), sol_field(j, k));
-                if (j < N_INTERIOR_CELLS) // Only for interior cells
-                    max_field(j, k) = std::max(max_field(j, k), sol_field(i, k));
-
-                min_field(i, k) = std::min(min_field(i, k), sol_field(i, k));
-                min_field(i, k) = std::min(min_field(i, k), sol_field(j, k));
-                if (j < N_INTERIOR_CELLS) // Only for interior cells
-                    min_field(j, k) = std::min(min_field(j, k), sol_field(i, k));
+                const Index j = cell_connectivity.neighbours[k];
+                const Scalar p_j = (j < N_INTERIOR_CELLS)
+                                       ? primvars(j, P)
+                                       : boundary_value(cell_connectivity.face_indices[k],
+                                                        EulerVec{primvars.get_variable<StorageEulerVec>(i).cast<Scalar>()})[P];
+                p_diff_sum += p_j - p_i;
+                p_sum += p_j + p_i;
             }
-        }
+            cell_marker[i] = abs(p_diff_sum) > threshold * p_sum; });
+
+        /*The interior neighbours of a cell are those having it as neighbour, so marking the neighbours of the
+        flagged cells is the same as taking the cells with a flagged neighbour*/
+        const Index chunk_size = thread_pool.get_chunk_size();
+        Vector<Vector<Index>> chunk_cells((N_INTERIOR_CELLS + chunk_size - 1) / chunk_size);
+        thread_pool.parallel_for_chunks(0, N_INTERIOR_CELLS, [&](Index first, Index last)
+                                        {
+            Vector<Index> &cells = chunk_cells[first / chunk_size];
+            for (Index i{first}; i < last; i++)
+            {
+                bool limited = cell_marker[i];
+                for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i) && !limited; k++)
+                    limited = cell_connectivity.neighbours[k] < N_INTERIOR_CELLS && cell_marker[cell_connectivity.neighbours[k]];
+                if (limited)
+                    cells.push_back(i);
+            } });
+
+        limited_cells.clear();
+        for (const Vector<Index> &cells : chunk_cells)
+            limited_cells.insert(limited_cells.end(), cells.begin(), cells.end());
+
+        /*The flagged cells are among the limited ones*/
+        thread_pool.parallel_for(0, limited_cells.size(), [&](Index n)
+                                 { cell_marker[limited_cells[n]] = 0; });
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "Grid.hpp"
 #include "Solver.hpp"
+#include "ThreadPool.hpp"
 
 /*This class has been written more generically, but it really wasnt necessary at this point,
 only flow::EulerVar is assumed*/
@@ -10,15 +11,59 @@ class Output
 private:
     const geom::Grid &grid;
     const Vector<unique_ptr<Solver>> &solvers;
+    ThreadPool &thread_pool;
+
+    /*One line per time step with current residual norms: the time step, the time, then the L2 and the Linf norms of
+    the equations of each solver*/
+    std::ofstream residual_history;
 
     void write_vtk_ascii_grid(const Config &config, string filename);
 
+    void write_vtk_ascii_files(const Config &config, bool write_grid_only);
+
 public:
-    Output(const geom::Grid &grid, const Vector<unique_ptr<Solver>> &solvers, const Config &config);
+    Output(const geom::Grid &grid, const Vector<unique_ptr<Solver>> &solvers, const Config &config, ThreadPool &thread_pool);
+
+    /*Writes the solution every write_stride time steps*/
     void write_vtk_ascii(const Config &config, bool write_grid_only = false);
+
+    /*Writes the solution of the last time step, unless write_vtk_ascii already has*/
+    void write_final_vtk_ascii(const Config &config);
+
+    void write_residual_history(const Config &config);
 };
 
+/*Writes write_line(ost, i) for i = 0 ... n_lines - 1 to ost. The lines are formatted in parallel, chunk by chunk,
+and written in order, so the file is the same for any number of threads*/
+template <typename WriteLine>
+void write_lines(std::ostream &ost, Index n_lines, ThreadPool &thread_pool, WriteLine &&write_line)
+{
+    const Index chunk_size = thread_pool.get_chunk_size();
+    Vector<string> chunk_text((n_lines + chunk_size - 1) / chunk_size);
+
+    thread_pool.parallel_for_chunks(0, n_lines, [&](Index first, Index last)
+                                    {
+        std::ostringstream chunk_ost;
+        for (Index i{first}; i < last; i++)
+            write_line(chunk_ost, i);
+        chunk_text[first / chunk_size] = chunk_ost.str(); });
+
+    for (const string &text : chunk_text)
+        ost << text;
+}
+
 struct EulerOutput
 {
-    static void write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars);
-};
\ No newline at end of file
+    static constexpr std::array<const char *, N_EQS_EULER> conservative_variable_names{"rho", "rho_u", "rho_v", "rho_w", "E"};
+
+
+    static void write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars,
+                                          ThreadPool &thread_pool);
+};
+
+/*The passive scalars phi of a solver, from rho * phi and the density of its conservative variables consvars*/
+struct PassiveScalarOutput
+{
+    static void write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars,
+                                          const PassiveScalarData &passive_scalars, ThreadPool &thread_pool);
+};
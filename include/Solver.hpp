@@ -5,103 +5,560 @@
 #include "../include/Utilities.hpp"
 #include "../include/Numerics.hpp"
 #include "../include/SolverData.hpp"
+#include "../include/MeshRegion.hpp"
+#include "../include/TaskGraph.hpp"
+#include "../include/ThreadPool.hpp"
+
+/*The solver pipeline is instantiated at compile time for every combination of the options below. Combinations
+that are never used can be excluded from the build (to reduce compile times) by defining the corresponding
+EXCLUDE_<OPTION> flag, for instance -DEXCLUDE_TVD_RK3. Selecting an excluded option at runtime gives an error.*/
+namespace pipeline
+{
+    constexpr bool included(TimeScheme time_scheme)
+    {
+        switch (time_scheme)
+        {
+#ifndef EXCLUDE_EXPLICIT_EULER
+        case TimeScheme::ExplicitEuler:
+            return true;
+#endif
+#ifndef EXCLUDE_TVD_RK3
+        case TimeScheme::TVD_RK3:
+            return true;
+#endif
+#ifndef EXCLUDE_LUSGS
+        case TimeScheme::LUSGS:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    constexpr bool included(SpatialOrder spatial_order)
+    {
+        switch (spatial_order)
+        {
+#ifndef EXCLUDE_FIRST_ORDER
+        case SpatialOrder::First:
+            return true;
+#endif
+#ifndef EXCLUDE_SECOND_ORDER
+        case SpatialOrder::Second:
+            return true;
+#endif
+#ifndef EXCLUDE_THIRD_ORDER
+        case SpatialOrder::Third:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    constexpr bool included(InviscidFluxScheme inv_flux_scheme)
+    {
+        switch (inv_flux_scheme)
+        {
+#ifndef EXCLUDE_RUSANOV
+        case InviscidFluxScheme::Rusanov:
+            return true;
+#endif
+#ifndef EXCLUDE_HLLC
+        case InviscidFluxScheme::HLLC:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    constexpr bool included(Limiter limiter)
+    {
+        switch (limiter)
+        {
+        case Limiter::NONE:
+            return true;
+#ifndef EXCLUDE_BARTH
+        case Limiter::Barth:
+            return true;
+#endif
+#ifndef EXCLUDE_VENKATAKRISHNAN
+        case Limiter::Venkatakrishnan:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    /*Viscous pipelines are those of the Navier-Stokes solver*/
+    constexpr bool included_viscous(bool viscous)
+    {
+#ifdef EXCLUDE_NAVIER_STOKES
+        return !viscous;
+#else
+        return true;
+#endif
+    }
+
+    /*Compile time options of a solver pipeline*/
+    template <TimeScheme TIME_SCHEME, SpatialOrder SPATIAL_ORDER, InviscidFluxScheme INV_FLUX_SCHEME, Limiter LIMITER, bool VISCOUS>
+    struct Options
+    {
+        static constexpr TimeScheme time_scheme = TIME_SCHEME;
+        static constexpr SpatialOrder spatial_order = SPATIAL_ORDER;
+        static constexpr InviscidFluxScheme inv_flux_scheme = INV_FLUX_SCHEME;
+        static constexpr Limiter limiter = LIMITER;
+        static constexpr bool viscous = VISCOUS;
+
+        static_assert(SPATIAL_ORDER == SpatialOrder::Second || LIMITER == Limiter::NONE,
+                      "Only second order pipelines use a limiter");
+        static_assert(SPATIAL_ORDER != SpatialOrder::First || !VISCOUS,
+                      "The viscous fluxes use the gradients of the reconstruction");
+    };
+}
+
+/*L2 (root mean square) and Linf norms over the interior cells of R_ij / Omega_i, the flux balance of equation j of
+cell i over its volume. Taken from the flux balance of the first stage of a step, which is the steady residual of the
+solution at the start of the step*/
+struct ResidualNorms
+{
+    Vector<Scalar> L2, Linf;
+};
 
 class Solver
 {
 protected:
     unique_ptr<SolverData> solver_data;
+
+    /*Passive scalars advanced together with the solution, null if there are none*/
+    unique_ptr<PassiveScalarData> passive_scalars;
+
     const geom::Grid &grid;
+    ThreadPool &thread_pool;
     unique_ptr<ValidityChecker> validity_checker;
 
     Vector<unique_ptr<BoundaryCondition>> BC_container;
 
+    /*Wall time spent in the different phases of the flux balance evaluation*/
+    map<string, Stopwatch> phase_timings;
+
+    /*Cell blocks of the temporal blocking, empty if it is off. cell_levels holds the levels of the cells in the
+    block being processed, see BlockRegion*/
+    Vector<CellBlock> cell_blocks;
+    Vector<ShortIndex> cell_levels;
+
+    /*Cells of the active blocks at level 0 and the stage halo around them when activity tracking is on, see
+    Config::activity_tolerance. The levels are kept in cell_levels. If active_region_only is set, the current step
+    evaluates the flux balance of and updates the active cells only*/
+    CellBlock active_region;
+    bool active_region_only{false};
+
+    /*Residual norms of the last step, not computed in the steps that only update the active region. They are reduced
+    from the sums and maxima of each chunk of cells of the thread pool, padded to a cache line per chunk, so that
+    they do not depend on the number of threads*/
+    ResidualNorms residual_norms, initial_residual_norms;
+    bool residual_norms_current{false};
+    Vector<Scalar> chunk_residual_sums, chunk_residual_max;
+
 public:
-    Solver(const geom::Grid &grid, const Config &config);
+    Solver(const geom::Grid &grid, const Config &config, ThreadPool &thread_pool);
 
-    void step(const Config &config);
+    virtual ~Solver() = default;
 
-    virtual void calc_timestep(Config &config) = 0;
+    /*Advances the solution one time step. The time step is computed during the step and set in config*/
+    virtual void step(Config &config) = 0;
 
     virtual SolverType get_solver_type() const = 0;
 
     const SolverData &get_solver_data() const { return *solver_data; }
 
-private:
-    void create_BC_container(const Config &config);
+    const PassiveScalarData *get_passive_scalars() const { return passive_scalars.get(); }
 
-    void evaluate_flux_balance(const Config &config, const VecField &cons_vars);
+    /*Residual norms of the solver's equations, current if they were computed in the last step. The initial norms
+    are those of the first step*/
+    const ResidualNorms &get_residual_norms() const { return residual_norms; }
+    const ResidualNorms &get_initial_residual_norms() const { return initial_residual_norms; }
+    bool has_current_residual_norms() const { return residual_norms_current; }
+
+    /*True if the norms of the last step are current and the L2 norm of the density residual has dropped by the given
+    number of orders of magnitude from the first step*/
+    bool residual_dropped(Scalar orders_of_magnitude) const
+    {
+        return residual_norms_current && residual_norms.L2[0] < initial_residual_norms.L2[0] * pow(10.0, -orders_of_magnitude);
+    }
+
+    void print_phase_timings() const;
+
+protected:
+    /*The time integration schemes take the flux balance evaluation of the calling pipeline as argument,
+    so that it is resolved at compile time. The evaluator is called with std::true_type as second argument
+    for the first stage of the step, which also computes the time step, and std::false_type otherwise*/
+    template <typename FluxBalanceEvaluator>
+    void explicit_euler(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance);
+
+    /*Calls f(i, j) for all components of field in memory order, chunk by chunk on the thread pool*/
+    template <typename Field, typename Function>
+    void parallel_for_all_in_memory_order(const Field &field, Function &&f)
+    {
+        thread_pool.parallel_for_chunks(0, field.size(), [&](Index first, Index last)
+                                        { field.for_range_in_memory_order(first, last, f); });
+    }
 
-    void update_cell_averages(VecField &U, double dt);
+    /*As parallel_for_all_in_memory_order, for the active cells only if active_region_only is set*/
+    template <typename Field, typename Function>
+    void parallel_for_updated_cells(const Field &field, Function &&f)
+    {
+        if (!active_region_only)
+        {
+            parallel_for_all_in_memory_order(field, f);
+            return;
+        }
+        const ShortIndex N_EQS = field.get_N_EQS();
+        thread_pool.parallel_for(0, active_region.level_offsets[1], [&](Index c)
+                                 {
+            const Index i = active_region.cells[c];
+            for (ShortIndex j{0}; j < N_EQS; j++)
+                f(i, j); });
+    }
 
-    virtual void evaluate_inviscid_fluxes(const Config &config) { return; };
+    /*Calls f(i, j) for all components of the solution in memory order as parallel_for_all_in_memory_order, and
+    computes the residual norms from the flux balance in the same pass*/
+    template <typename Function>
+    void parallel_for_all_with_residual_norms(Function &&f);
+
+    /*Calls f(U, U_old, R, i, j) as parallel_for_updated_cells for the solution U, old solution U_old and flux
+    balance R of the solver, then for those of the passive scalars, so that the time schemes advance both with the
+    same stages. With CALC_RESIDUAL_NORMS the residual norms of the solver are computed while updating all cells,
+    used by the first stage*/
+    template <bool CALC_RESIDUAL_NORMS = false, typename Function>
+    void parallel_update_integrated_fields(Function &&f)
+    {
+        auto update = [&](VecField &U, const VecField &U_old, const VecField &R)
+        {
+            parallel_for_updated_cells(U, [&](Index i, Index j)
+                                       { f(U, U_old, R, i, j); });
+        };
+        VecField &U = solver_data->get_solution();
+        if (CALC_RESIDUAL_NORMS && !active_region_only)
+            parallel_for_all_with_residual_norms([&](Index i, Index j)
+                                                 { f(U, solver_data->get_solution_old(), solver_data->get_flux_balance(), i, j); });
+        else
+            update(U, solver_data->get_solution_old(), solver_data->get_flux_balance());
+        if (passive_scalars)
+            update(passive_scalars->get_solution(), passive_scalars->get_solution_old(), passive_scalars->get_flux_balance());
+    }
 
-    virtual void evaluate_viscous_fluxes(const Config &config) { return; };
+    /*Returns the time step over the volume of cell i as a function of i. The time step is the one of the cell with
+    local time stepping and the global one otherwise, both set by the first flux balance evaluation of the step*/
+    auto time_step_over_volume(const Config &config) const
+    {
+        return [&cells = grid.get_cells(), &local_delta_time = solver_data->get_local_delta_time(),
+                dt = config.get_delta_time()](Index i)
+        { return (local_delta_time.empty() ? dt : local_delta_time[i]) / cells[i].cell_volume; };
+    }
 
-    virtual void set_constant_ghost_values(const Config &config) = 0;
+    template <typename FluxBalanceEvaluator>
+    void TVD_RK3(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance);
+
+    /*TVD_RK3 where the second and third stage are advanced one cell block at a time, so that the data of a block
+    stay in cache between the stages. The first stage gives the time step, a minimum over all cells, and is
+    evaluated for all cells. evaluate_region_flux_balance(cons_vars, region) computes the flux balance of the
+    cells in a BlockRegion*/
+    template <typename FluxBalanceEvaluator, typename RegionFluxBalanceEvaluator>
+    void TVD_RK3_temporal_blocking(const Config &config,
+                                   FluxBalanceEvaluator &&evaluate_flux_balance,
+                                   RegionFluxBalanceEvaluator &&evaluate_region_flux_balance);
+
+    /*Number of cell layers around the updated cells that one flux balance evaluation reads from, one for the
+    face neighbours and one more for their gradients and limiters at second order*/
+    static ShortIndex stage_halo_width(const Config &config)
+    {
+        return config.get_spatial_order() == SpatialOrder::Second ? 2 : 1;
+    }
 
-    void explicit_euler(const Config &config);
+    /*Splits the interior cells, in their order in the grid, into blocks whose data fit in temporal_block_size_kb.
+    Each block gets the 2 * stage_halo_width layers of neighbours needed to advance it through two stages*/
+    void create_cell_blocks(const Config &config);
 
-    void TVD_RK3(const Config &config);
+    /*Adds to block, holding the cells of level 0 with these marked in cell_levels, the layers of neighbours up to
+    level n_levels - 1 and the faces of the cells below the last level. The levels of the added cells are left in
+    cell_levels*/
+    void add_halo_levels(CellBlock &block, ShortIndex n_levels);
 
-    virtual void evaluate_gradient(const Config &config) = 0;
+    /*Sets active_region to active_cells, in increasing order, with the stage halo around them*/
+    void create_active_region(const Config &config, const Vector<Index> &active_cells);
 
-    virtual void evaluate_limiter(const Config &config) = 0;
+private:
+    void create_BC_container(const Config &config);
 };
 
 class EulerSolver : public Solver
 {
 
 public:
-    EulerSolver(const Config &config, const geom::Grid &grid);
+    EulerSolver(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool);
 
-    void calc_timestep(Config &config) override;
+    /*Creates the solver pipeline matching the options in config*/
+    static unique_ptr<Solver> create(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool);
 
     SolverType get_solver_type() const override { return SolverType::Euler; }
 
+protected:
+    /*Primitive variables of the ghost cells are stored and set once per flux evaluation. If not, see
+    calc_boundary_primvars*/
+    const bool store_ghost_cells;
+
+    void set_constant_ghost_values(const Config &config);
+
+    /*Ghost values of the boundary faces in region only*/
+    void set_constant_ghost_values(const BlockRegion &region);
+
+    /*Sets the stored ghost value of boundary face ij. Thread safe*/
+    void set_ghost_value(Index ij);
+
+    /*Primitive variables of the ghost cell of boundary face ij, where V_i is the value in the domain cell.
+    Read from the stored ghost cells if present, otherwise computed from the boundary condition of the face*/
+    EulerVec calc_boundary_primvars(Index ij, const EulerVec &V_i) const;
+
+    /*Index of the patch containing boundary face ij*/
+    Index find_patch_index(Index ij) const;
+
+    /*Parameters of the viscous fluxes of the Navier-Stokes solver, see NS_Solver. The heat conduction coefficient
+    multiplies the gradient of p / rho, and the time step factor scales the viscous spectral radius of a face to
+    its weight in the time step*/
+    const Scalar viscosity;
+    const Scalar heat_conduction;
+    const Scalar viscous_time_step_factor;
+
+    /*Subtracts the viscous flux through face ij from flux, the inviscid flux of the face, and returns the weighted
+    viscous spectral radius, to be added to the convective one. The face gradients are built from the primitive
+    variable gradients of the reconstruction. Thread safe*/
+    template <typename EulerVecType>
+    Scalar subtract_viscous_flux(Index ij, bool boundary_face, EulerVecType &flux) const;
+
+    /*Calls f(k, flux) with the flux of passive scalar k through face ij for the mass flux mass_flux from cell i of
+    the face to cell j or the boundary. The scalar is taken first order upwind from the cell the mass flux leaves,
+    or at its free stream value for inflow through a far field boundary. Thread safe*/
+    template <typename Function>
+    void for_scalar_face_fluxes(Index ij, bool boundary_face, Scalar mass_flux, Function &&f) const;
+
+    /*Adds the passive scalar fluxes of face ij to the scalar flux balance of cell i if update_i, and of cell j if
+    update_j and ij is an interior face*/
+    void add_scalar_face_fluxes(Index ij, bool boundary_face, Scalar mass_flux, bool update_i = true, bool update_j = true);
+
+    /*Sets the scalar flux balance of cell i from the mass fluxes of its faces in face_fluxes*/
+    void gather_scalar_face_fluxes(Index i);
+
+    template <typename Region>
+    void evaluate_gradient(const Config &config, const Region &region);
+
+    template <Limiter LIMITER, typename Region>
+    void evaluate_limiter(const Config &config, const Region &region);
+
+    /*Gradient and Hessian of the quadratic reconstruction of all interior cells, see Grid::calc_kexact_stencils*/
+    void evaluate_kexact_fit(const Config &config);
+
+    /*Newton iterations of the fast math kernels of the Rusanov flux, 0 = exact. A runtime option, since the
+    kernels are picked per face at no measurable cost and the other flux schemes do not use them*/
+    const ShortIndex math_iterations;
+
+    /*Sets the time step from the spectral radii accumulated in the first flux evaluation of the step*/
+    void calc_timestep(Config &config);
+
+    /*Implicit step with the matrix-free LU-SGS scheme, see the comment in the definition. The flux balance
+    evaluator is called once, as the first stage of the explicit schemes*/
+    template <typename FluxBalanceEvaluator>
+    void LU_SGS(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance);
+
+    /*Order of the interior cells in the forward sweep of LU-SGS, and the position of each cell in it. The cells
+    before a cell in the sweep are its lower neighbours, those after it the upper ones. Only set for LUSGS*/
+    Vector<Index> sweep_order;
+    Vector<Index> sweep_position;
+
+    /*Sets sweep_order to the reverse Cuthill-McKee order of the interior cells*/
+    void create_sweep_order(const Config &config);
+
+    /*When frozen, the limiter values of the last evaluation are reused for the rest of the run*/
+    bool limiter_frozen{false};
+
+    /*Freezes the limiter when the criteria in config are met. Called after each time step*/
+    void update_limiter_freezing(const Config &config);
+
+    /*Cells flagged by the shock sensor in the last limiter evaluation, used when limiter_shock_sensor is set*/
+    Vector<Index> limited_cells;
+    Vector<uint8_t> limited_cell_marker;
+    size_t n_limited_cells_step{0};
+    size_t n_limiter_evaluations_step{0};
+
+    /*Prints the fraction of cells limited during the last time step*/
+    void report_limited_cells(const Config &config);
+
+    /*Free stream scales of the conservative variables and the cells marked during update_activity, see
+    Config::activity_tolerance*/
+    array<Scalar, N_EQS_EULER> activity_scales{};
+    Vector<uint8_t> activity_marker;
+
+    /*Sets the active region of the next step from the cells that changed in the last one, and prints the fraction
+    of cells updated in the last step. Called after each time step, before the old solution is overwritten*/
+    void update_activity(const Config &config);
+
+    /*Interior faces split into tiles, empty if face tiling is off. Tile t has the faces
+    [face_tile_offsets[t], face_tile_offsets[t + 1]) and the cells tile_cells[tile_cell_offsets[t]...
+    tile_cell_offsets[t + 1]). tile_face_cells holds the indices of i and j of each face within its tile*/
+    Vector<Index> face_tile_offsets;
+    Vector<Index> tile_cell_offsets;
+    Vector<Index> tile_cells;
+    Vector<array<Index, 2>> tile_face_cells;
+
+    /*Cell data gathered for the tile being processed*/
+    Vector<StorageEulerVec> tile_primvars;
+    Vector<StorageEulerGrad> tile_gradients;
+    Vector<StorageEulerVec> tile_limiters;
+    Vector<EulerVec> tile_flux_balance;
+    Vector<Scalar> tile_spectral_radii;
+
+    /*Splits the interior faces, in their order in the grid, into tiles where the data of the referenced cells
+    fit in face_tile_size_kb*/
+    void create_face_tiles(const Config &config);
+
+    /*Tasks of the flux balance evaluation, one per phase and cell partition, empty if task_partitions is 0.
+    Task phase * n_task_partitions + p does the phase for the cells [p * partition_size, (p + 1) * partition_size)*/
+    enum class TaskPhase : ShortIndex
+    {
+        Primvars,
+        Gradient,
+        Limiter,
+        Fluxes,
+        FluxBalance,
+        N_PHASES
+    };
+    TaskGraph flux_balance_tasks;
+    Index n_task_partitions{0};
+    Index partition_size{0};
+
+    /*Fluxes and spectral radii times area of the faces, written by the Fluxes tasks and summed per cell by the
+    FluxBalance tasks, and likewise by the deterministic parallel flux evaluation*/
+    Vector<EulerVec> face_fluxes;
+    Vector<Scalar> face_spectral_radii;
+
+    /*The phases of a partition depend on the previous phase of the partition itself and of the partitions
+    sharing a face with it. The interior faces are evaluated by the partition of cell i*/
+    void create_flux_balance_task_graph(const Config &config);
+};
+
+/*Euler solver where the time scheme, spatial order, flux scheme and limiter are fixed at compile time,
+so that no configuration branches are left in the loops over faces and cells*/
+template <typename Options>
+class EulerSolverPipeline final : public EulerSolver
+{
+public:
+    EulerSolverPipeline(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+        : EulerSolver(config, grid, thread_pool) {}
+
+    void step(Config &config) final;
+
+    SolverType get_solver_type() const final { return Options::viscous ? SolverType::NavierStokes : SolverType::Euler; }
+
 private:
-    void evaluate_inviscid_fluxes(const Config &config) final;
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_flux_balance(const Config &config, const VecField &cons_vars);
+
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_inviscid_fluxes(const Config &config);
+
+    /*Interior face fluxes computed tile by tile on gathered cell data, see create_face_tiles*/
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_tiled_interior_fluxes();
 
-    void set_constant_ghost_values(const Config &config) final;
+    /*evaluate_flux_balance executing flux_balance_tasks*/
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_flux_balance_tasks(const Config &config, const VecField &cons_vars);
 
-    void evaluate_gradient(const Config &config) final;
+    /*Inviscid fluxes with the faces distributed over the thread pool, used when it has more than one thread. The
+    fluxes are either buffered and summed per cell, or added to the cells with atomic updates, see
+    Config::deterministic_accumulation*/
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_parallel_inviscid_fluxes(const Config &config);
 
-    void evaluate_limiter(const Config &config) final;
+    /*Sets the flux balance (and spectral radius) of cell i to the sum of the buffered fluxes of its faces. The
+    faces of a cell are in increasing order, as in the face loops of evaluate_inviscid_fluxes, so the sums are the
+    same as those of the serial loops*/
+    template <bool CALC_SPECTRAL_RADII>
+    void gather_face_fluxes(Index i);
 
-    void calc_reconstructed_value(Index i,
-                                  EulerVecMap &V_L,
-                                  const Vec3 &r_im,
-                                  SpatialOrder spatial_order);
+    /*Inviscid flux through face ij, returning the spectral radius times the face area. Thread safe*/
+    Scalar calc_face_flux(Index ij, bool boundary_face, EulerVec &flux);
 
-    /*Delta S is used to compute time step following the 2nd method in Blazek.
-    Only needs recalculating when the grid is updated*/
-    void calc_Delta_S(const Config &config);
+    /*Flux balance of the cells in region, see TVD_RK3_temporal_blocking. Used as well for the active region of the
+    activity tracking, where the spectral radii of the region cells are updated in the first stage*/
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_region_flux_balance(const Config &config, const VecField &cons_vars, const BlockRegion &region);
+
+    template <bool CALC_SPECTRAL_RADII>
+    void evaluate_region_inviscid_fluxes(const BlockRegion &region);
+
+    void calc_reconstructed_value(Index i, EulerVecMap &V_L, const Vec3 &r_im);
 };
 
-inline void EulerSolver::calc_reconstructed_value(Index i,
-                                                  EulerVecMap &V_L,
-                                                  const Vec3 &r_im,
-                                                  SpatialOrder spatial_order)
+template <typename Function>
+inline void EulerSolver::for_scalar_face_fluxes(Index ij, bool boundary_face, Scalar mass_flux, Function &&f) const
 {
+    const auto &face = grid.get_faces()[ij];
+    const VecField &scalars = passive_scalars->get_solution();
+    const ShortIndex N_SCALARS = passive_scalars->get_N_SCALARS();
+
+    if (boundary_face && mass_flux < 0.0 && grid.get_patches()[find_patch_index(ij)].boundary_type == BoundaryType::FarField)
+    {
+        for (ShortIndex k{0}; k < N_SCALARS; k++)
+            f(k, mass_flux * passive_scalars->get_freestream_value(k));
+        return;
+    }
 
-    const VecField &primvars = solver_data->get_primvars();
-    const GradField &primvars_grad = solver_data->get_primvars_gradient();
-    const VecField &primvars_limiter = solver_data->get_primvars_limiter();
+    const Index donor = (mass_flux >= 0.0 || boundary_face) ? face.i : face.j;
+    const Scalar volume_flux = mass_flux / solver_data->get_primvars()(donor, primvars_index::Density);
+    for (ShortIndex k{0}; k < N_SCALARS; k++)
+        f(k, volume_flux * scalars(donor, k));
+}
 
-    const EulerVecMap V_i = primvars.get_variable<EulerVec>(i);
+template <typename Options>
+inline void EulerSolverPipeline<Options>::calc_reconstructed_value(Index i, EulerVecMap &V_L, const Vec3 &r_im)
+{
+    const StorageEulerVecMap V_i = solver_data->get_primvars().get_variable<StorageEulerVec>(i);
 
-    if (spatial_order == SpatialOrder::Second)
+    if constexpr (Options::spatial_order == SpatialOrder::Third)
     {
-        const EulerGradMap V_i_grad = primvars_grad.get_variable<EulerGrad>(i);
-        const EulerVecMap limiter_i = primvars_limiter.get_variable<EulerVec>(i);
-
-        Reconstruction::calc_limited_reconstruction(V_i, V_i_grad, limiter_i, r_im, V_L);
+        const StorageEulerGradMap V_i_grad = solver_data->get_primvars_gradient().get_variable<StorageEulerGrad>(i);
+        const StorageEulerHessianMap V_i_hessian = solver_data->get_primvars_hessian().get_variable<StorageEulerHessian>(i);
+        Reconstruction::calc_quadratic_reconstruction(V_i, V_i_grad, V_i_hessian, grid.get_kexact_stencils().moments[i], r_im, V_L);
+    }
+    else if constexpr (Options::spatial_order == SpatialOrder::Second)
+    {
+        const StorageEulerGradMap V_i_grad = solver_data->get_primvars_gradient().get_variable<StorageEulerGrad>(i);
+
+        if constexpr (Options::limiter != Limiter::NONE)
+        {
+            const StorageEulerVecMap limiter_i = solver_data->get_primvars_limiter().get_variable<StorageEulerVec>(i);
+            Reconstruction::calc_limited_reconstruction(V_i, V_i_grad, limiter_i, r_im, V_L);
+        }
+        else
+        {
+            Reconstruction::calc_unlimited_reconstruction(V_i, V_i_grad, r_im, V_L);
+        }
     }
     else
-    { // Spatial order == First
-        V_L = V_i;
+    {
+        V_L = V_i.cast<Scalar>();
     }
 }
 
-class NS_Solver : public EulerSolver
+/*The Navier-Stokes solver is the Euler solver with viscous pipelines, which add the viscous flux of each face in
+the face loops of the inviscid flux, see EulerSolver::subtract_viscous_flux. The gas has a constant viscosity and
+Prandtl number, and the walls are adiabatic*/
+class NS_Solver
 {
-};
\ No newline at end of file
+public:
+    /*Creates the viscous solver pipeline matching the options in config*/
+    static unique_ptr<Solver> create(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool);
+};
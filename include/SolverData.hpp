@@ -3,23 +3,53 @@
 #include "containers/DynamicContainer.hpp"
 #include "containers/StaticContainer.hpp"
 #include "Config.hpp"
+#include "FastMath.hpp"
+
+/*Memory layout of each kind of field, see layout:: in containers/DynamicContainer.hpp. Set at compile time with
+FIELD_LAYOUTS in src/Makefile, for instance -DGRAD_FIELD_LAYOUT=layout::SoA or -DSTORAGE_FIELD_LAYOUT="layout::AoSoA<8>"*/
+#ifndef VEC_FIELD_LAYOUT
+#define VEC_FIELD_LAYOUT layout::AoS
+#endif
+#ifndef STORAGE_FIELD_LAYOUT
+#define STORAGE_FIELD_LAYOUT layout::AoS
+#endif
+#ifndef GRAD_FIELD_LAYOUT
+#define GRAD_FIELD_LAYOUT layout::AoS
+#endif
+
+template <typename T, typename Layout>
+struct BasicVecField final : public DynamicContainer2D<T, Layout>
+{
+    BasicVecField(Index N_CELLS, ShortIndex N_EQS, const FieldAllocator &allocator = FieldAllocator{})
+        : DynamicContainer2D<T, Layout>(N_CELLS, N_EQS, allocator) {}
+
+    ShortIndex get_N_EQS() const { return this->rows(); }
+
+    using DynamicContainer2D<T, Layout>::operator=;
+};
+
+/*Conservative variables and flux balances*/
+using VecField = BasicVecField<Scalar, VEC_FIELD_LAYOUT>;
+/*Primitive variables and limiters, see USE_MIXED_PRECISION*/
+using StorageVecField = BasicVecField<StorageScalar, STORAGE_FIELD_LAYOUT>;
 
-struct VecField final : public DynamicContainer2D<Scalar>
+struct GradField final : public DynamicContainer3D<StorageScalar, N_DIM, GRAD_FIELD_LAYOUT>
 {
-    VecField(Index N_CELLS, ShortIndex N_EQS) : DynamicContainer2D(N_CELLS, N_EQS) {}
+    GradField(Index N_CELLS, ShortIndex N_EQS, const FieldAllocator &allocator = FieldAllocator{})
+        : DynamicContainer3D(N_CELLS, N_EQS, allocator) {}
 
     ShortIndex get_N_EQS() const { return rows(); }
 
-    using DynamicContainer2D<Scalar>::operator=;
+    using DynamicContainer3D<StorageScalar, N_DIM, GRAD_FIELD_LAYOUT>::operator=;
 };
 
-struct GradField final : public DynamicContainer3D<Scalar, N_DIM>
+/*Second derivatives of the quadratic k-exact reconstruction, in the order of geom::quadratic_monomials*/
+struct HessianField final : public DynamicContainer3D<StorageScalar, N_HESSIAN, GRAD_FIELD_LAYOUT>
 {
-    GradField(Index N_CELLS, ShortIndex N_EQS) : DynamicContainer3D(N_CELLS, N_EQS) {}
+    HessianField(Index N_CELLS, ShortIndex N_EQS, const FieldAllocator &allocator = FieldAllocator{})
+        : DynamicContainer3D(N_CELLS, N_EQS, allocator) {}
 
     ShortIndex get_N_EQS() const { return rows(); }
-
-    using DynamicContainer3D<Scalar, N_DIM>::operator=;
 };
 
 class SolverData
@@ -27,18 +57,28 @@ class SolverData
 protected:
     unique_ptr<VecField> solution,
         solution_old,
-        primvars,
         flux_balance;
 
+    unique_ptr<StorageVecField> primvars;
+
     unique_ptr<GradField> primvars_gradient;
 
-    unique_ptr<VecField> primvars_limiter,
-        primvars_max,
-        primvars_min;
+    unique_ptr<StorageVecField> primvars_limiter;
+
+    /*Only allocated at third order*/
+    unique_ptr<HessianField> primvars_hessian;
+
+    /*Solutions after the first and second stage of TVD_RK3, only allocated with temporal blocking*/
+    unique_ptr<VecField> solution_stage_1,
+        solution_stage_2;
+
+    /*Time step of each interior cell, only allocated with local time stepping*/
+    Vector<Scalar> local_delta_time;
 
     // SolverData() = default;
 
-    SolverData(const Config &config, ShortIndex n_eqs);
+    /*The fields are first touched on the threads of thread_pool, see FieldAllocator*/
+    SolverData(const Config &config, ShortIndex n_eqs, ThreadPool &thread_pool);
 
 public:
     virtual ShortIndex get_N_EQS() const = 0;
@@ -49,23 +89,26 @@ public:
     VecField &get_solution_old() { return *solution_old; }
     const VecField &get_solution_old() const { return *solution_old; }
 
+    VecField &get_solution_stage_1() { return *solution_stage_1; }
+    VecField &get_solution_stage_2() { return *solution_stage_2; }
+
+    Vector<Scalar> &get_local_delta_time() { return local_delta_time; }
+    const Vector<Scalar> &get_local_delta_time() const { return local_delta_time; }
+
     VecField &get_flux_balance() { return *flux_balance; }
     const VecField &get_flux_balance() const { return *flux_balance; }
 
-    VecField &get_primvars() { return *primvars; }
-    const VecField &get_primvars() const { return *primvars; }
+    StorageVecField &get_primvars() { return *primvars; }
+    const StorageVecField &get_primvars() const { return *primvars; }
 
     GradField &get_primvars_gradient() { return *primvars_gradient; }
     const GradField &get_primvars_gradient() const { return *primvars_gradient; }
 
-    VecField &get_primvars_limiter() { return *primvars_limiter; }
-    const VecField &get_primvars_limiter() const { return *primvars_limiter; }
-
-    VecField &get_primvars_max() { return *primvars_max; }
-    const VecField &get_primvars_max() const { return *primvars_max; }
+    StorageVecField &get_primvars_limiter() { return *primvars_limiter; }
+    const StorageVecField &get_primvars_limiter() const { return *primvars_limiter; }
 
-    VecField &get_primvars_min() { return *primvars_min; }
-    const VecField &get_primvars_min() const { return *primvars_min; }
+    HessianField &get_primvars_hessian() { return *primvars_hessian; }
+    const HessianField &get_primvars_hessian() const { return *primvars_hessian; }
 
     virtual SolverType get_solver_type() const = 0;
 
@@ -85,16 +128,25 @@ using EulerGrad = FlowGrad<N_EQS_EULER>;
 using EulerVecMap = Eigen::Map<EulerVec>;
 using EulerGradMap = Eigen::Map<EulerGrad>;
 
+using StorageEulerVec = Eigen::Vector<StorageScalar, N_EQS_EULER>;
+using StorageEulerGrad = Eigen::Matrix<StorageScalar, N_EQS_EULER, N_DIM>;
+using StorageEulerHessian = Eigen::Matrix<StorageScalar, N_EQS_EULER, N_HESSIAN>;
+
+/*Views of single cells of the fields, strided unless the field layout is AoS*/
+using StorageEulerVecMap = StorageVecField::VariableMap<StorageEulerVec>;
+using StorageEulerGradMap = GradField::VariableMap<StorageEulerGrad>;
+using StorageEulerHessianMap = HessianField::VariableMap<StorageEulerHessian>;
+
 class EulerSolverData : public SolverData
 {
 
     EulerVec U_L, U_R, V_L, V_R;
     EulerVec Flux_inv;
 
-    Vector<Vec3> Delta_S; // Used in time step computation
+    Vector<Scalar> spectral_radii; // Sum of the convective spectral radii times face area of each cell, used for the time step
 
 public:
-    EulerSolverData(const Config &config);
+    EulerSolverData(const Config &config, ThreadPool &thread_pool);
 
     ShortIndex get_N_EQS() const final { return N_EQS_EULER; };
 
@@ -108,14 +160,49 @@ public:
 
     EulerVecMap get_empty_map() const { return EulerVecMap(nullptr); }
 
-    Vector<Vec3> &get_Delta_S() { return Delta_S; }
-    const Vector<Vec3> &get_Delta_S() const { return Delta_S; }
+    Vector<Scalar> &get_spectral_radii() { return spectral_radii; }
+    const Vector<Scalar> &get_spectral_radii() const { return spectral_radii; }
 
     void set_primvars(const VecField &cons_vars, const Config &config) final;
 
+    /*Primitive variables of interior cell i only*/
+    inline void set_primvars(const VecField &cons_vars, Index i);
+
+    /*Primitive variables of the interior cells [first, last)*/
+    inline void set_primvars(const VecField &cons_vars, Index first, Index last);
+
     void set_freestream_values(const Config &config);
 };
 
+/*Conservative variables rho * phi of the passive scalars phi carried by the flow of a main solver, one component
+per scalar. The scalars are advanced in the time steps of the main solver, which adds their fluxes in its own face
+loops from its mass fluxes, see EulerSolver::for_scalar_face_fluxes*/
+class PassiveScalarData
+{
+    unique_ptr<VecField> solution,
+        solution_old,
+        flux_balance;
+
+    Vector<Scalar> freestream_values;
+
+public:
+    /*The scalars start at their initial values in the free stream density*/
+    PassiveScalarData(const Config &config, ThreadPool &thread_pool);
+
+    ShortIndex get_N_SCALARS() const { return freestream_values.size(); }
+
+    VecField &get_solution() { return *solution; }
+    const VecField &get_solution() const { return *solution; }
+
+    VecField &get_solution_old() { return *solution_old; }
+    const VecField &get_solution_old() const { return *solution_old; }
+
+    VecField &get_flux_balance() { return *flux_balance; }
+    const VecField &get_flux_balance() const { return *flux_balance; }
+
+    Scalar get_freestream_value(ShortIndex k) const { return freestream_values[k]; }
+};
+
 /*Discontinuing StaticContainer, using Eigen instead*/
 
 // template<ShortIndex N_EQS>
@@ -135,16 +222,18 @@ namespace EulerEqs
     template <typename EulerVecType>
     inline void prim_to_cons(const EulerVecType &V, EulerVecType &U);
 
-    template <typename EulerVecType>
-    inline void cons_to_prim(const EulerVecType &U, EulerVecType &V);
+    /*The primitive variables may be stored in a different precision than the conservative ones*/
+    template <typename EulerVecType, typename PrimVecType>
+    inline void cons_to_prim(const EulerVecType &U, PrimVecType &V);
 
     template <typename EulerVecType>
     inline Scalar pressure(const EulerVecType &U);
 
-    template <typename EulerVecType>
+    /*MATH_ITER is the number of Newton iterations of the fast math kernels, 0 gives the exact functions*/
+    template <ShortIndex MATH_ITER = 0, typename EulerVecType>
     inline Scalar sound_speed_conservative(const EulerVecType &U);
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER = 0, typename EulerVecType>
     inline Scalar sound_speed_primitive(const EulerVecType &V);
 
     template <typename EulerVecType>
@@ -153,13 +242,13 @@ namespace EulerEqs
     template <typename EulerVecType>
     inline Scalar conv_spectral_radii(const EulerVecType &U, const Vec3 &normal);
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER = 0, typename EulerVecType>
     inline Scalar conv_spectral_radii(const EulerVecType &U, const Vec3 &normal);
 
     template <typename EulerVecType>
     inline EulerVec inviscid_flux(const EulerVecType &U, const Vec3 &normal);
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER = 0, typename EulerVecType>
     inline Scalar entropy_primitive(const EulerVecType &V);
 
     template <typename EulerVecType>
@@ -176,11 +265,12 @@ namespace EulerEqs
         assert(U[4] > 0.0);
     }
 
-    template <typename EulerVecType>
-    inline void cons_to_prim(const EulerVecType &U, EulerVecType &V)
+    template <typename EulerVecType, typename PrimVecType>
+    inline void cons_to_prim(const EulerVecType &U, PrimVecType &V)
     {
 
         static_assert(EulerVecType::RowsAtCompileTime == N_EQS_EULER and EulerVecType::ColsAtCompileTime == 1);
+        static_assert(PrimVecType::RowsAtCompileTime == N_EQS_EULER and PrimVecType::ColsAtCompileTime == 1);
         V[0] = U[0],
         V[1] = U[1] / U[0],
         V[2] = U[2] / U[0],
@@ -200,20 +290,35 @@ namespace EulerEqs
         return p;
     }
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER, typename EulerVecType>
     inline Scalar sound_speed_conservative(const EulerVecType &U)
     {
         static_assert(EulerVecType::RowsAtCompileTime == N_EQS_EULER && EulerVecType::ColsAtCompileTime == 1);
-        Scalar c = sqrt(GAMMA * pressure(U) / U[0]);
+        Scalar c;
+        if constexpr (MATH_ITER == 0)
+            c = sqrt(GAMMA * pressure(U) / U[0]);
+        else
+        {
+            // c = sqrt(gamma * p / rho) = gamma * p / sqrt(gamma * p * rho), avoiding the division
+            const Scalar gamma_p = GAMMA * pressure(U);
+            c = gamma_p * fast_math::rsqrt<MATH_ITER>(gamma_p * U[0]);
+        }
         assert(num_is_valid_and_pos(c));
         return c;
     }
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER, typename EulerVecType>
     inline Scalar sound_speed_primitive(const EulerVecType &V)
     {
         static_assert(EulerVecType::RowsAtCompileTime == N_EQS_EULER && EulerVecType::ColsAtCompileTime == 1);
-        Scalar c = sqrt(GAMMA * V[4] / V[0]);
+        Scalar c;
+        if constexpr (MATH_ITER == 0)
+            c = sqrt(GAMMA * V[4] / V[0]);
+        else
+        {
+            const Scalar gamma_p = GAMMA * V[4];
+            c = gamma_p * fast_math::rsqrt<MATH_ITER>(gamma_p * V[0]);
+        }
         assert(num_is_valid_and_pos(c));
         return c;
     }
@@ -227,11 +332,11 @@ namespace EulerEqs
         return vel_n;
     }
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER, typename EulerVecType>
     inline Scalar conv_spectral_radii(const EulerVecType &U, const Vec3 &normal)
     {
         static_assert(EulerVecType::RowsAtCompileTime == N_EQS_EULER && EulerVecType::ColsAtCompileTime == 1);
-        Scalar lambda = abs(projected_velocity(U, normal)) + sound_speed_conservative(U);
+        Scalar lambda = abs(projected_velocity(U, normal)) + sound_speed_conservative<MATH_ITER>(U);
         assert(num_is_valid_and_pos(lambda));
         return lambda;
     }
@@ -254,13 +359,65 @@ namespace EulerEqs
         return F;
     }
 
-    template <typename EulerVecType>
+    template <ShortIndex MATH_ITER, typename EulerVecType>
     inline Scalar entropy_primitive(const EulerVecType &V)
     {
         // s = p / rho^gamma
-        return V[4] * pow(V[0], -EulerEqs::GAMMA);
+        return V[4] * fast_math::pow_minus_gamma<MATH_ITER>(V[0]);
+    }
+
+    /*Batched variants working on the cells [first, last) of whole fields, the results of cell i being written to
+    cell i of the output field or to entry i - first of the output array. The loops run over the cells with the
+    components as separate scalars, so that they vectorize across cells, contiguously for the SoA and AoSoA layouts.
+    The values are the same as those of the single cell functions. Unlike these, the batched functions do not
+    assert that the results are physical, so that they can be used by the validity checks*/
+
+    template <typename ConsField, typename PrimField>
+    inline void cons_to_prim(const ConsField &U, PrimField &V, Index first, Index last)
+    {
+        assert(U.get_N_EQS() == N_EQS_EULER && V.get_N_EQS() == N_EQS_EULER && last <= U.size() && last <= V.size());
+#pragma GCC ivdep
+        for (Index i = first; i < last; i++)
+        {
+            const Scalar rho = U(i, 0);
+            const Scalar rho_u = U(i, 1), rho_v = U(i, 2), rho_w = U(i, 3);
+            V(i, 0) = rho;
+            V(i, 1) = rho_u / rho;
+            V(i, 2) = rho_v / rho;
+            V(i, 3) = rho_w / rho;
+            V(i, 4) = GAMMA_MINUS_ONE * (U(i, 4) - 0.5 / rho * (rho_u * rho_u + rho_v * rho_v + rho_w * rho_w));
+        }
+    }
+
+    template <typename ConsField>
+    inline void pressure(const ConsField &U, Index first, Index last, Scalar *p)
+    {
+        assert(U.get_N_EQS() == N_EQS_EULER && last <= U.size());
+#pragma GCC ivdep
+        for (Index i = first; i < last; i++)
+        {
+            const Scalar rho_u = U(i, 1), rho_v = U(i, 2), rho_w = U(i, 3);
+            p[i - first] = GAMMA_MINUS_ONE * (U(i, 4) - 0.5 / U(i, 0) * (rho_u * rho_u + rho_v * rho_v + rho_w * rho_w));
+        }
     }
+}
+
+/*The values are gathered component-wise rather than through maps of whole cells, so that a loop over cells can be
+vectorized when the fields are stored SoA or AoSoA*/
+inline void EulerSolverData::set_primvars(const VecField &cons_vars, Index i)
+{
+    EulerVec U_i;
+    StorageEulerVec V_i;
+    for (ShortIndex k{0}; k < N_EQS_EULER; k++)
+        U_i[k] = cons_vars(i, k);
+    EulerEqs::cons_to_prim(U_i, V_i);
+    for (ShortIndex k{0}; k < N_EQS_EULER; k++)
+        (*primvars)(i, k) = V_i[k];
+}
 
+inline void EulerSolverData::set_primvars(const VecField &cons_vars, Index first, Index last)
+{
+    EulerEqs::cons_to_prim(cons_vars, *primvars, first, last);
 }
 
 /*Implements various mechanisms for checking if the various containers (solutions, fluxes etc) contain physical solutions*/
@@ -272,7 +429,7 @@ protected:
     Index check_field_validity(const VecField &field, Index first, Index last) const;
 
     /*Special check for primvars (for instance, for Euler eqs. density and pressure must be positive)*/
-    virtual Index check_primvars(const VecField &V, Index first, Index last) const = 0;
+    virtual Index check_primvars(const StorageVecField &V, Index first, Index last) const = 0;
 
     virtual Index check_consvars(const VecField &U, Index first, Index last) const = 0;
 
@@ -283,17 +440,18 @@ public:
 
     void check_flux_balance_validity(const Config &config, const VecField &flux_balance) const;
 
-    bool valid_primvars_interior(const VecField &V) const;
+    bool valid_primvars_interior(const StorageVecField &V) const;
 
     bool valid_consvars_interior(const VecField &U) const;
 
-    bool valid_primvars_ghost(const VecField &V) const;
+    bool valid_primvars_ghost(const StorageVecField &V) const;
 
     bool valid_consvars_ghost(const VecField &U) const;
 
     bool valid_flux_balance(const VecField &R) const;
 
-    void write_debug_info(const VecField &U, string name = "") const;
+    template <typename T, typename Layout>
+    void write_debug_info(const BasicVecField<T, Layout> &U, string name = "") const;
 
     virtual bool valid_boundary_flux(const Scalar *flux_vals, BoundaryType bc_type) const = 0;
 };
@@ -301,7 +459,7 @@ public:
 class EulerValidityChecker : public ValidityChecker
 {
 
-    Index check_primvars(const VecField &V, Index first, Index last) const final;
+    Index check_primvars(const StorageVecField &V, Index first, Index last) const final;
 
     Index check_consvars(const VecField &U, Index first, Index last) const final;
 
@@ -312,3 +470,24 @@ class EulerValidityChecker : public ValidityChecker
 public:
     EulerValidityChecker(const Config &config) : ValidityChecker(config) {}
 };
+
+template <typename T, typename Layout>
+void ValidityChecker::write_debug_info(const BasicVecField<T, Layout> &U, string name) const
+{
+    std::ofstream ost{DEBUG_LOG_FILE, std::ios::app};
+    FAIL_IF_MSG(!ost, "Couldn't open file debugging logging file " + string(DEBUG_LOG_FILE));
+
+    ost << "\n\nDisplaying vector field " + name + "\n\n";
+    for (Index i{0}; i < U.size(); i++)
+    {
+        for (ShortIndex j{0}; j < U.get_N_EQS(); j++)
+        {
+            ost << U(i, j);
+            if (j < U.get_N_EQS() - 1)
+                ost << ", ";
+        }
+        if (i >= config.get_N_INTERIOR_CELLS())
+            ost << " -G";
+        ost << "\n";
+    }
+}
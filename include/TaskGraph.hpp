@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Includes.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <thread>
+
+/*Dependency graph of tasks, identified by their index. execute runs every task once on the workers of a thread
+pool, each task after all its prerequisites. A task becomes ready when its last prerequisite finishes and is taken
+from a ready queue shared by the workers. The worker finishing a task keeps one of the tasks it made ready and runs
+it next, so that the phases of a partition tend to stay on the same worker. There are no barriers between the
+tasks, so tasks from different stages of a pipeline can run at the same time. The graph is built once and can be
+executed any number of times*/
+class TaskGraph
+{
+    Vector<Index> n_prerequisites;
+    Vector<pair<Index, Index>> dependencies; // (prerequisite, task), only used while building
+
+    /*Compressed sparse row (CSR) lists of the tasks waiting for each task*/
+    Vector<Index> successor_offsets;
+    Vector<Index> successors;
+
+    /*Prerequisites not yet finished in the current execution*/
+    unique_ptr<std::atomic<Index>[]> n_remaining;
+
+    /*Ready queue of the current execution. Every task is pushed once, so slot s holds the s-th task made ready,
+    plus one, and 0 while the slot is being written*/
+    unique_ptr<std::atomic<Index>[]> ready_tasks;
+
+    struct alignas(64) PaddedCounter
+    {
+        std::atomic<Index> value{0};
+    };
+    PaddedCounter n_pushed, n_popped, n_finished;
+    std::atomic<bool> failed{false};
+
+    void push_ready(Index task)
+    {
+        const Index slot = n_pushed.value.fetch_add(1, std::memory_order_relaxed);
+        ready_tasks[slot].store(task + 1, std::memory_order_release);
+    }
+
+    bool pop_ready(Index &task);
+
+    /*Runs ready tasks until all tasks have finished*/
+    template <typename RunTask>
+    void run_ready_tasks(RunTask &run_task);
+
+public:
+    Index add_task()
+    {
+        n_prerequisites.push_back(0);
+        return n_prerequisites.size() - 1;
+    }
+
+    /*Adding the same dependency more than once has no effect*/
+    void add_dependency(Index prerequisite, Index task)
+    {
+        assert(prerequisite < n_tasks() && task < n_tasks() && prerequisite != task);
+        dependencies.emplace_back(prerequisite, task);
+    }
+
+    /*Must be called after the last task and dependency has been added. The graph must be acyclic*/
+    void finalize();
+
+    Index n_tasks() const { return n_prerequisites.size(); }
+    Index n_dependencies() const { return successors.size(); }
+
+    /*run_task(task) is called from several workers of thread_pool at the same time, for tasks that do not depend on
+    each other. It must not use thread_pool itself. If a task throws, no further tasks are started and the first
+    exception is rethrown*/
+    template <typename RunTask>
+    void execute(ThreadPool &thread_pool, RunTask &&run_task);
+};
+
+inline void TaskGraph::finalize()
+{
+    std::sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+    std::fill(n_prerequisites.begin(), n_prerequisites.end(), 0);
+    successor_offsets.assign(n_tasks() + 1, 0);
+    successors.clear();
+    for (const auto &[prerequisite, task] : dependencies)
+    {
+        successor_offsets[prerequisite + 1]++;
+        successors.push_back(task);
+        n_prerequisites[task]++;
+    }
+    for (Index t{0}; t < n_tasks(); t++)
+        successor_offsets[t + 1] += successor_offsets[t];
+
+    dependencies.clear();
+    dependencies.shrink_to_fit();
+    n_remaining = make_unique<std::atomic<Index>[]>(n_tasks());
+    ready_tasks = make_unique<std::atomic<Index>[]>(n_tasks());
+}
+
+template <typename RunTask>
+void TaskGraph::execute(ThreadPool &thread_pool, RunTask &&run_task)
+{
+    assert(successor_offsets.size() == n_tasks() + 1); // finalize has been called
+
+    for (Index t{0}; t < n_tasks(); t++)
+    {
+        n_remaining[t].store(n_prerequisites[t], std::memory_order_relaxed);
+        ready_tasks[t].store(0, std::memory_order_relaxed);
+    }
+    n_pushed.value.store(0, std::memory_order_relaxed);
+    n_popped.value.store(0, std::memory_order_relaxed);
+    n_finished.value.store(0, std::memory_order_relaxed);
+    failed.store(false, std::memory_order_relaxed);
+
+    for (Index t{0}; t < n_tasks(); t++)
+        if (n_prerequisites[t] == 0)
+            push_ready(t);
+
+    /*Starting the pool loop publishes the state above to the workers*/
+    thread_pool.parallel_for_workers([&]
+                                     { run_ready_tasks(run_task); });
+}
+
+inline bool TaskGraph::pop_ready(Index &task)
+{
+    Index slot = n_popped.value.load(std::memory_order_relaxed);
+    while (slot < n_pushed.value.load(std::memory_order_acquire))
+    {
+        if (n_popped.value.compare_exchange_weak(slot, slot + 1, std::memory_order_relaxed))
+        {
+            /*The slot has been claimed by its pusher, which may not have written it yet*/
+            Index entry;
+            while ((entry = ready_tasks[slot].load(std::memory_order_acquire)) == 0)
+                std::this_thread::yield();
+            task = entry - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename RunTask>
+void TaskGraph::run_ready_tasks(RunTask &run_task)
+{
+    constexpr Index NO_TASK = std::numeric_limits<Index>::max();
+
+    while (n_finished.value.load(std::memory_order_acquire) < n_tasks() && !failed.load(std::memory_order_relaxed))
+    {
+        Index task;
+        if (!pop_ready(task))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        while (task != NO_TASK)
+        {
+            try
+            {
+                run_task(task);
+            }
+            catch (...)
+            {
+                failed.store(true, std::memory_order_relaxed);
+                throw;
+            }
+
+            /*The release and acquire make the results of all prerequisites visible to the task made ready last*/
+            Index next_task = NO_TASK;
+            for (Index s{successor_offsets[task]}; s < successor_offsets[task + 1]; s++)
+                if (n_remaining[successors[s]].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (next_task == NO_TASK)
+                        next_task = successors[s];
+                    else
+                        push_ready(successors[s]);
+                }
+
+            n_finished.value.fetch_add(1, std::memory_order_release);
+            task = next_task;
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Includes.hpp"
+#include "Utilities.hpp"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+/*Persistent pool of worker threads, created once by the Driver and shared by the grid, the solvers and the output.
+An index range is split into chunks of chunk_size indices. Each worker starts with a contiguous share of the
+chunks, so that the same indices go to the same worker from one loop to the next as long as the load is even.
+A worker that runs out of chunks steals half of the remaining chunks of another worker.
+The calling thread takes part as worker 0, so a pool of one thread runs everything on the calling thread.
+Loops can not be nested. The workers can be pinned to cores, see select_worker_cores*/
+class ThreadPool
+{
+public:
+    struct WorkerStatistics
+    {
+        double busy_seconds{0.0}; // Time spent running chunks
+        size_t n_chunks{0};
+        size_t n_stolen_chunks{0};
+        size_t n_steals{0};
+    };
+
+    /*Core and NUMA node of a pinned worker*/
+    struct WorkerPlacement
+    {
+        int core;
+        int numa_node;
+    };
+
+    /*Cores of the workers for the given affinity, empty for ThreadAffinity::None. The cores are taken among those
+    the process may run on, grouped by NUMA node as listed by Linux in /sys/devices/system/node*/
+    static Vector<WorkerPlacement> select_worker_cores(ThreadAffinity affinity, const Vector<int> &core_list, ShortIndex n_threads);
+
+    /*The workers are pinned to worker_cores if not empty, worker w to worker_cores[w]*/
+    ThreadPool(ShortIndex n_threads, Index chunk_size, const Vector<WorkerPlacement> &worker_cores = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ShortIndex get_n_threads() const { return n_threads; }
+    Index get_chunk_size() const { return chunk_size; }
+
+    /*Calls f(chunk_first, chunk_last) for the chunks of [first, last)*/
+    template <typename Function>
+    void parallel_for_chunks(Index first, Index last, Function &&f);
+
+    /*Calls f(i) for all i in [first, last)*/
+    template <typename Function>
+    void parallel_for(Index first, Index last, Function &&f)
+    {
+        parallel_for_chunks(first, last, [&f](Index chunk_first, Index chunk_last)
+                            {
+            for (Index i{chunk_first}; i < chunk_last; i++)
+                f(i); });
+    }
+
+    /*Returns reduce(...reduce(reduce(identity, f(first)), f(first + 1))..., f(last - 1)), where the values are
+    reduced chunk by chunk and the chunk results in chunk order, so that the result does not depend on which
+    worker ran which chunk*/
+    template <typename T, typename Function, typename Reduce>
+    T parallel_reduce(Index first, Index last, T identity, Function &&f, Reduce &&reduce);
+
+    /*Calls f() once per chunk of a loop of one chunk per worker, for work that the workers hand out among
+    themselves, see TaskGraph::execute. A worker that is late to start may have its call stolen by another worker,
+    so f must not wait for the other calls*/
+    template <typename Function>
+    void parallel_for_workers(Function &&f)
+    {
+        run(n_threads, [](const void *context, Index)
+            { (*static_cast<std::remove_reference_t<Function> *>(const_cast<void *>(context)))(); },
+            &f);
+    }
+
+    void print_statistics() const;
+
+    /*Prints the core and NUMA node of each worker and the range of cells it starts with in a loop over n_cells*/
+    void print_placement(Index n_cells) const;
+
+private:
+    using ChunkFunction = void (*)(const void *context, Index chunk);
+
+    /*Chunk range [begin, end) of a worker, packed in one word so that the owner and the thieves can update it
+    with a single compare and swap. The owner takes chunks from the front, thieves from the back*/
+    struct alignas(64) ChunkQueue
+    {
+        std::atomic<uint64_t> range{0};
+    };
+
+    struct alignas(64) PaddedStatistics
+    {
+        WorkerStatistics statistics;
+    };
+
+    const ShortIndex n_threads;
+    const Index chunk_size;
+
+    Vector<std::thread> threads;
+    Vector<WorkerPlacement> worker_cores;
+    unique_ptr<ChunkQueue[]> queues;
+    unique_ptr<PaddedStatistics[]> worker_statistics;
+
+    /*Current loop*/
+    ChunkFunction run_chunk{nullptr};
+    const void *chunk_context{nullptr};
+
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    size_t generation{0};
+    ShortIndex n_busy_workers{0};
+    bool stopping{false};
+
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+
+    static uint64_t pack(Index begin, Index end) { return (uint64_t(end) << 32) | begin; }
+    static Index range_begin(uint64_t range) { return Index(range); }
+    static Index range_end(uint64_t range) { return Index(range >> 32); }
+
+    /*The chunks worker starts with in a loop of n_chunks chunks*/
+    pair<Index, Index> initial_chunks(ShortIndex worker, Index n_chunks) const
+    {
+        return {size_t(worker) * n_chunks / n_threads, size_t(worker + 1) * n_chunks / n_threads};
+    }
+
+    /*Runs run_chunk on chunks 0 ... n_chunks - 1 on all workers and returns when all are done*/
+    void run(Index n_chunks, ChunkFunction chunk_function, const void *context);
+
+    void worker_loop(ShortIndex worker);
+
+    /*Runs the chunks of the own queue, then the chunks stolen from the others until all queues are empty*/
+    void work(ShortIndex worker);
+
+    bool pop_chunk(ShortIndex worker, Index &chunk);
+
+    bool steal_chunks(ShortIndex thief, ShortIndex victim);
+
+    void run_chunk_timed(ShortIndex worker, Index chunk);
+};
+
+template <typename Function>
+void ThreadPool::parallel_for_chunks(Index first, Index last, Function &&f)
+{
+    if (first >= last)
+        return;
+
+    struct Context
+    {
+        Index first, last, chunk_size;
+        Function &f;
+    };
+    const Context context{first, last, chunk_size, f};
+
+    const Index n_chunks = (last - first + chunk_size - 1) / chunk_size;
+    run(n_chunks, [](const void *context_ptr, Index chunk)
+        {
+            const Context &c = *static_cast<const Context *>(context_ptr);
+            const Index chunk_first = c.first + chunk * c.chunk_size;
+            c.f(chunk_first, std::min(chunk_first + c.chunk_size, c.last)); },
+        &context);
+}
+
+template <typename T, typename Function, typename Reduce>
+T ThreadPool::parallel_reduce(Index first, Index last, T identity, Function &&f, Reduce &&reduce)
+{
+    if (first >= last)
+        return identity;
+
+    const Index n_chunks = (last - first + chunk_size - 1) / chunk_size;
+    Vector<T> chunk_results(n_chunks, identity);
+
+    parallel_for_chunks(first, last, [&](Index chunk_first, Index chunk_last)
+                        {
+        T result = identity;
+        for (Index i{chunk_first}; i < chunk_last; i++)
+            result = reduce(result, f(i));
+        chunk_results[(chunk_first - first) / chunk_size] = result; });
+
+    T result = identity;
+    for (const T &chunk_result : chunk_results)
+        result = reduce(result, chunk_result);
+    return result;
+}
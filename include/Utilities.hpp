@@ -8,6 +8,9 @@ constexpr ShortIndex N_TET_FACES{4};
 
 constexpr ShortIndex N_EQS_EULER{N_DIM + 2};
 
+constexpr ShortIndex N_HESSIAN{6};                   // Independent second derivatives, in the order xx, yy, zz, xy, xz, yz
+constexpr ShortIndex N_KEXACT_COEFFS{N_DIM + N_HESSIAN}; // Derivatives fitted by the quadratic k-exact reconstruction
+
 namespace primvars_index
 {
     static constexpr ShortIndex Density{0};
@@ -25,19 +28,23 @@ namespace primvars_index
 // --------------------------------------------------------------------
 enum class MainSolverType
 {
-    Euler
+    Euler,
+    NavierStokes
 };
 
 const map<string, MainSolverType> main_solver_from_string{
-    {"Euler", MainSolverType::Euler}};
+    {"Euler", MainSolverType::Euler},
+    {"NavierStokes", MainSolverType::NavierStokes}};
 
 enum class SolverType
 {
-    Euler
+    Euler,
+    NavierStokes
 }; // The main solver can (but need not) be comprised of multiple sub solvers
 
 const map<SolverType, string> string_from_solver_type{
-    {SolverType::Euler, "Euler"}};
+    {SolverType::Euler, "Euler"},
+    {SolverType::NavierStokes, "NavierStokes"}};
 
 enum class TimeIntegrationType
 {
@@ -48,30 +55,36 @@ enum class TimeIntegrationType
 enum class TimeScheme
 {
     ExplicitEuler,
-    TVD_RK3
+    TVD_RK3,
+    LUSGS
 };
 
 const map<string, TimeScheme> time_scheme_from_string{
     {"ExplicitEuler", TimeScheme::ExplicitEuler},
-    {"TVD_RK3", TimeScheme::TVD_RK3}};
+    {"TVD_RK3", TimeScheme::TVD_RK3},
+    {"LUSGS", TimeScheme::LUSGS}};
 
 enum class SpatialOrder
 {
     First,
-    Second
+    Second,
+    Third
 };
 
 const map<string, SpatialOrder> spatial_order_from_string{
     {"First", SpatialOrder::First},
-    {"Second", SpatialOrder::Second}};
+    {"Second", SpatialOrder::Second},
+    {"Third", SpatialOrder::Third}};
 
 enum class GradientScheme
 {
-    GreenGauss
+    GreenGauss,
+    LeastSquares
 };
 
 const map<string, GradientScheme> gradient_scheme_from_string{
-    {"GreenGauss", GradientScheme::GreenGauss}};
+    {"GreenGauss", GradientScheme::GreenGauss},
+    {"LeastSquares", GradientScheme::LeastSquares}};
 
 enum class InviscidFluxScheme
 {
@@ -86,12 +99,68 @@ const map<string, InviscidFluxScheme> inviscid_flux_scheme_from_string{
 enum class Limiter
 {
     NONE,
-    Barth
+    Barth,
+    Venkatakrishnan
 };
 
 const map<string, Limiter> limiter_from_string{
     {"NONE", Limiter::NONE},
-    {"Barth", Limiter::Barth}};
+    {"Barth", Limiter::Barth},
+    {"Venkatakrishnan", Limiter::Venkatakrishnan}};
+
+enum class MathKernels
+{
+    Exact,
+    Fast
+};
+
+const map<string, MathKernels> math_kernels_from_string{
+    {"Exact", MathKernels::Exact},
+    {"Fast", MathKernels::Fast}};
+
+/*Pinning of the worker threads of the thread pool to cores, see Config::thread_affinity*/
+enum class ThreadAffinity
+{
+    None,
+    Compact,
+    Scatter,
+    List
+};
+
+const map<string, ThreadAffinity> thread_affinity_from_string{
+    {"None", ThreadAffinity::None},
+    {"Compact", ThreadAffinity::Compact},
+    {"Scatter", ThreadAffinity::Scatter},
+    {"List", ThreadAffinity::List}};
+
+/*Parses a list of CPU numbers in the Linux format, such as "0-3,8,10-11"*/
+inline Vector<int> parse_cpu_list(const string &list)
+{
+    Vector<int> cpus;
+    std::stringstream ss{list};
+    string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.find_first_not_of(" \n\t") == string::npos)
+            continue;
+        const size_t dash = item.find('-');
+        int first, last;
+        try
+        {
+            first = std::stoi(item.substr(0, dash));
+            last = dash == string::npos ? first : std::stoi(item.substr(dash + 1));
+        }
+        catch (const std::logic_error &)
+        {
+            first = last = -1;
+        }
+        if (first < 0 || last < first)
+            throw std::runtime_error("Illegal CPU list '" + list + "'");
+        for (int cpu{first}; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
 
 enum class BoundaryType
 {
@@ -120,6 +189,8 @@ namespace standard_air
     constexpr Scalar density{1.225};
     constexpr Scalar pressure{101325.0};
     constexpr Scalar temperature = pressure / (density * gas_constant);
+    constexpr Scalar dynamic_viscosity{1.789e-5};
+    constexpr Scalar prandtl_number{0.72};
 }
 
 namespace geom
@@ -170,14 +241,15 @@ namespace geom
 
     struct Face
     {
-        Face(Index i, Index j, Vec3 S_ij, Vec3 r_im, Vec3 r_jm) : S_ij{S_ij}, i{i}, j{j}, r_im{r_im}, r_jm{r_jm} {}
+        Face(Index i, Index j, const Vec3 &S_ij, const Vec3 &r_im, const Vec3 &r_jm)
+            : S_ij{S_ij.cast<StorageScalar>()}, i{i}, j{j}, r_im{r_im.cast<StorageScalar>()}, r_jm{r_jm.cast<StorageScalar>()} {}
         Face(Index i, Index j) : i{i}, j{j} {}
-        Vec3 S_ij;       // Area normal vector from cell i to j
-        Index i, j;      // Indices of cell i and j
-        Vec3 r_im, r_jm; // vectors from each cell center to the face centroid
+        StorageVec3 S_ij;       // Area normal vector from cell i to j
+        Index i, j;             // Indices of cell i and j
+        StorageVec3 r_im, r_jm; // vectors from each cell center to the face centroid
         friend std::ostream &operator<<(std::ostream &os, const Face &f)
         {
-            os << "(i,j) = (" << f.i << "," << f.j << "), S_ij: " + horizontal_string_Vec3(f.S_ij) + ", r_im: " + horizontal_string_Vec3(f.r_im) + ", r_jm: " + horizontal_string_Vec3(f.r_jm) << endl;
+            os << "(i,j) = (" << f.i << "," << f.j << "), S_ij: " + horizontal_string_Vec3(f.S_ij.cast<Scalar>()) + ", r_im: " + horizontal_string_Vec3(f.r_im.cast<Scalar>()) + ", r_jm: " + horizontal_string_Vec3(f.r_jm.cast<Scalar>()) << endl;
             return os;
         }
 
@@ -205,6 +277,44 @@ namespace geom
         }
     };
 
+    /*Compressed sparse row (CSR) adjacency of the interior cells. The faces of cell i are stored in
+    face_indices[offsets[i]] ... face_indices[offsets[i + 1] - 1] in increasing order, and neighbours holds the
+    cell on the other side of each of these faces (a ghost cell for boundary faces)*/
+    struct CellConnectivity
+    {
+        Vector<Index> offsets;
+        Vector<Index> face_indices;
+        Vector<Index> neighbours;
+
+        Index begin(Index i) const { return offsets[i]; }
+        Index end(Index i) const { return offsets[i + 1]; }
+    };
+
+    using KExactWeights = Eigen::Vector<StorageScalar, N_KEXACT_COEFFS>;
+    using QuadraticVec = Eigen::Vector<Scalar, N_HESSIAN>;
+
+    /*Quadratic monomials of r in the order of the Hessian components, 1/2 * r_a * r_a for the squares and
+    r_a * r_b for the mixed terms, so that the quadratic term of a Taylor expansion is hessian * monomials*/
+    inline QuadraticVec quadratic_monomials(const Vec3 &r)
+    {
+        return QuadraticVec{0.5 * r.x() * r.x(), 0.5 * r.y() * r.y(), 0.5 * r.z() * r.z(), r.x() * r.y(), r.x() * r.z(), r.y() * r.z()};
+    }
+
+    /*Stencils of the quadratic k-exact reconstruction of the interior cells. The stencil of cell i is its face
+    neighbours, in the order of the cell connectivity, followed by the interior cells outer_cells[offsets[i]] ...
+    outer_cells[offsets[i + 1] - 1] of the next layers of face neighbours. Cell i has one weight vector per stencil
+    cell, starting at weights[begin_weights(i)]. moments[i] holds the second moments of cell i about its centroid
+    in the form of quadratic_monomials, that is the mean of quadratic_monomials(x - x_i) over the cell*/
+    struct KExactStencils
+    {
+        Vector<Index> offsets;
+        Vector<Index> outer_cells;
+        Vector<KExactWeights> weights;
+        Vector<Eigen::Vector<StorageScalar, N_HESSIAN>> moments;
+
+        Index begin_weights(Index i, const CellConnectivity &cell_connectivity) const { return cell_connectivity.begin(i) + offsets[i]; }
+    };
+
     struct Patch
     {
         BoundaryType boundary_type;
@@ -294,6 +404,8 @@ namespace geom
         Tetrahedron(Vec3 a, Vec3 b, Vec3 c, Vec3 d) : Polyhedra() { nodes = {a, b, c, d}; }
         Scalar calc_volume() const final;
         Vec3 calc_centroid() const final;
+        /*Mean of quadratic_monomials(x - centroid) over the tetrahedron*/
+        QuadraticVec calc_second_moments() const;
     };
 
     void assign_face_properties(Face &face, const Facegeom &face_geom, const Vec3 &cell_center_i, const Vec3 &cell_center_j);
@@ -1,14 +1,119 @@
 #pragma once
 #include "../Includes.hpp"
 #include "StaticContainer.hpp"
+#include "FieldAllocator.hpp"
+
+/*Memory layouts of the dynamic containers. A container holds N variables, each a rows x cols matrix whose
+components are numbered k = i + j * rows (column-major, as in Eigen). The layouts are
+AoS:   the components of each variable are contiguous, [l][k]
+SoA:   each component is contiguous over all variables, [k][l]
+AoSoA: the variables are grouped in blocks of BLOCK_WIDTH, stored SoA within each block, [l / W][k][l % W]
+Each layout gives the offset of a component, the Eigen::Map type viewing a whole variable, which is strided
+for SoA and AoSoA, and a loop over the components of the variables [first, last) in the order they are stored*/
+namespace layout
+{
+    struct AoS
+    {
+        template <typename StaticEigenType>
+        using Map = Eigen::Map<StaticEigenType>;
+
+        static constexpr bool contiguous_variables = true;
+
+        static size_t allocated_size(Index size, Index n_components) { return size_t(size) * n_components; }
+
+        static size_t offset(Index l, Index k, Index size, Index n_components) { return size_t(l) * n_components + k; }
+
+        template <typename StaticEigenType, typename T>
+        static Map<StaticEigenType> map(T *data, Index l, Index size)
+        {
+            return Map<StaticEigenType>(data + size_t(l) * StaticEigenType::SizeAtCompileTime);
+        }
+
+        template <typename Function>
+        static void for_range_in_memory_order(Index first, Index last, Index size, Index n_components, Function &&f)
+        {
+            for (Index l{first}; l < last; l++)
+                for (Index k{0}; k < n_components; k++)
+                    f(l, k);
+        }
+    };
+
+    struct SoA
+    {
+        template <typename StaticEigenType>
+        using Map = Eigen::Map<StaticEigenType, Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+        static constexpr bool contiguous_variables = false;
+
+        static size_t allocated_size(Index size, Index n_components) { return size_t(size) * n_components; }
+
+        static size_t offset(Index l, Index k, Index size, Index n_components) { return size_t(k) * size + l; }
+
+        template <typename StaticEigenType, typename T>
+        static Map<StaticEigenType> map(T *data, Index l, Index size)
+        {
+            return Map<StaticEigenType>(data + l, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(StaticEigenType::RowsAtCompileTime * size, size));
+        }
+
+        template <typename Function>
+        static void for_range_in_memory_order(Index first, Index last, Index size, Index n_components, Function &&f)
+        {
+            for (Index k{0}; k < n_components; k++)
+                for (Index l{first}; l < last; l++)
+                    f(l, k);
+        }
+    };
+
+    template <Index BLOCK_WIDTH>
+    struct AoSoA
+    {
+        static_assert(BLOCK_WIDTH > 0);
+
+        template <typename StaticEigenType>
+        using Map = Eigen::Map<StaticEigenType, Eigen::Unaligned, Eigen::Stride<StaticEigenType::RowsAtCompileTime * BLOCK_WIDTH, BLOCK_WIDTH>>;
+
+        static constexpr bool contiguous_variables = false;
+
+        /*The last block is padded to the full width*/
+        static size_t allocated_size(Index size, Index n_components)
+        {
+            return size_t(size + BLOCK_WIDTH - 1) / BLOCK_WIDTH * BLOCK_WIDTH * n_components;
+        }
+
+        static size_t offset(Index l, Index k, Index size, Index n_components)
+        {
+            return size_t(l / BLOCK_WIDTH) * BLOCK_WIDTH * n_components + size_t(k) * BLOCK_WIDTH + l % BLOCK_WIDTH;
+        }
+
+        template <typename StaticEigenType, typename T>
+        static Map<StaticEigenType> map(T *data, Index l, Index size)
+        {
+            return Map<StaticEigenType>(data + size_t(l / BLOCK_WIDTH) * BLOCK_WIDTH * StaticEigenType::SizeAtCompileTime + l % BLOCK_WIDTH);
+        }
+
+        template <typename Function>
+        static void for_range_in_memory_order(Index first, Index last, Index size, Index n_components, Function &&f)
+        {
+            for (Index l_block{first / BLOCK_WIDTH * BLOCK_WIDTH}; l_block < last; l_block += BLOCK_WIDTH)
+            {
+                const Index l_first = std::max(l_block, first);
+                const Index l_end = std::min(l_block + BLOCK_WIDTH, last);
+                for (Index k{0}; k < n_components; k++)
+                    for (Index l{l_first}; l < l_end; l++)
+                        f(l, k);
+            }
+        }
+    };
+}
 
 /*Dynamic container used to hold solution variables
 The type below is used to store vectors of matrices (such as gradients).
-They are stored in this fashion [A0, A1 ... Ai ... AN], where Ai is a MxN matrix.
+They are stored in this fashion [A0, A1 ... Ai ... AN], where Ai is a MxN matrix, in the memory layout given
+by Layout (see above).
 M will typically represent the number of solution variables, while
 It is assumed that the number of colums of the matrices N is known at compile time*/
 
-template <typename T, ShortIndex cols_>
+template <typename T, ShortIndex cols_, typename Layout = layout::AoS>
 class DynamicContainer3D
 {
 
@@ -20,58 +125,93 @@ protected:
 
     T *data_{nullptr};
 
+    /*Number of allocated values, which includes the padding of the layout*/
+    size_t n_values() const { return Layout::allocated_size(size_, rows_ * cols_); }
+
+    size_t offset(Index l, Index k) const { return Layout::offset(l, k, size_, rows_ * cols_); }
+
+    /*Zeroes the storage variable by variable on the thread pool, which hands out the chunks of the cell loops to
+    the same threads, so that the pages holding a range of cells are first touched, and thereby placed on the NUMA
+    node, by the thread that later works on the range*/
+    void first_touch(ThreadPool *thread_pool)
+    {
+        const Index n_components = rows_ * cols_;
+        const Index padded_size = n_components > 0 ? Index(n_values() / n_components) : 0;
+
+        auto zero = [&](Index first, Index last)
+        {
+            for (Index l{first}; l < last; l++)
+                for (Index k{0}; k < n_components; k++)
+                    data_[offset(l, k)] = 0;
+        };
+
+        if (thread_pool)
+            thread_pool->parallel_for_chunks(0, padded_size, zero);
+        else
+            zero(0, padded_size);
+    }
+
 public:
-    DynamicContainer3D(Index size, Index rows) : size_{size}, rows_{rows}
+    template <typename StaticEigenType>
+    using VariableMap = typename Layout::template Map<StaticEigenType>;
+
+    DynamicContainer3D(Index size, Index rows, const FieldAllocator &allocator = FieldAllocator{})
+        : size_{size}, rows_{rows}
     {
-        data_ = new T[size_ * rows_ * cols_]{0};
+        data_ = static_cast<T *>(allocator.allocate(n_values() * sizeof(T)));
+        first_touch(allocator.thread_pool);
     }
 
+    DynamicContainer3D(const DC3D &other) = delete;
+
     T &operator()(Index l, Index i, Index j)
     {
         assert(l < size_ && i < rows_ && j < cols_);
-        return data_[l * rows_ * cols_ + i * cols_ + j];
+        return data_[offset(l, i + j * rows_)];
     }
 
     const T &operator()(Index l, Index i, Index j) const
     {
         assert(l < size_ && i < rows_ && j < cols_);
-        return data_[l * rows_ * cols_ + i * cols_ + j];
+        return data_[offset(l, i + j * rows_)];
     }
 
-    /*Returns pointer to matrix l*/
+    /*Returns pointer to matrix l, only for layouts where it is contiguous*/
     T *operator[](Index l)
     {
+        static_assert(Layout::contiguous_variables);
         assert(l < size_);
         return data_ + l * rows_ * cols_;
     }
     const T *operator[](Index l) const
     {
+        static_assert(Layout::contiguous_variables);
         assert(l < size_);
         return data_ + l * rows_ * cols_;
     }
 
     void operator*=(T rhs)
     {
-        for (Index i{0}; i < size_ * rows_ * cols_; i++)
+        for (size_t i{0}; i < n_values(); i++)
             data_[i] *= rhs;
     }
 
     void operator=(T rhs)
     {
-        for (Index i{0}; i < size_ * rows_ * cols_; i++)
+        for (size_t i{0}; i < n_values(); i++)
             data_[i] = rhs;
     }
 
     void set_zero()
     {
-        for (size_t i{0}; i < size_ * rows_ * cols_; i++)
+        for (size_t i{0}; i < n_values(); i++)
             data_[i] = 0;
     }
 
     void operator=(const DC3D &other)
     {
-        assert(size() == other.size());
-        std::copy(other.data_, other.data_ + size_ * rows_ * cols_, data_);
+        assert(size() == other.size() && rows() == other.rows());
+        std::copy(other.data_, other.data_ + n_values(), data_);
     }
 
     template <typename StaticEigenType>
@@ -79,7 +219,8 @@ public:
     {
         assert(StaticEigenType::RowsAtCompileTime == rows_);
         static_assert(StaticEigenType::ColsAtCompileTime == cols_);
-        std::copy(variable.data(), variable.data() + StaticEigenType::SizeAtCompileTime, (*this)[l]);
+        using StoredType = Eigen::Matrix<T, StaticEigenType::RowsAtCompileTime, cols_>;
+        get_variable<StoredType>(l) = variable.template cast<T>();
     }
 
     template <typename StaticEigenType>
@@ -99,23 +240,25 @@ public:
     }
 
     template <typename StaticEigenType>
-    Eigen::Map<StaticEigenType> get_variable(Index l)
+    VariableMap<StaticEigenType> get_variable(Index l)
     {
         assert(StaticEigenType::RowsAtCompileTime == rows_ && StaticEigenType::ColsAtCompileTime == cols_);
-        return Eigen::Map<StaticEigenType>(data_ + l * rows_ * cols_);
+        assert(l < size_);
+        return Layout::template map<StaticEigenType>(data_, l, size_);
     }
 
     template <typename StaticEigenType>
-    const Eigen::Map<StaticEigenType> get_variable(Index l) const
+    const VariableMap<StaticEigenType> get_variable(Index l) const
     {
         assert(StaticEigenType::RowsAtCompileTime == rows_ && StaticEigenType::ColsAtCompileTime == cols_);
-        return Eigen::Map<StaticEigenType>(data_ + l * rows_ * cols_);
+        assert(l < size_);
+        return Layout::template map<StaticEigenType>(data_, l, size_);
     }
 
     /*Checks all values for nan or inf*/
     bool values_are_valid() const
     {
-        for (Index i{0}; i < size_ * rows_ * cols_; i++)
+        for (size_t i{0}; i < n_values(); i++)
             if (!num_is_valid(data_[i]))
                 return false;
         return true;
@@ -129,36 +272,53 @@ public:
     Index rows() const { return rows_; }
     static constexpr Index cols() { return cols_; }
 
-    ~DynamicContainer3D() { delete[] data_; }
+    ~DynamicContainer3D() { FieldAllocator::deallocate(data_); }
 };
 
-template <typename T>
-class DynamicContainer2D : public DynamicContainer3D<T, 1>
+template <typename T, typename Layout = layout::AoS>
+class DynamicContainer2D : public DynamicContainer3D<T, 1, Layout>
 {
-    using DC2D = DynamicContainer3D<T, 1>;
+    using DC2D = DynamicContainer3D<T, 1, Layout>;
 
 public:
     using DC2D::operator=;
 
     DynamicContainer2D() {}
 
-    DynamicContainer2D(Index size, Index rows) : DynamicContainer3D<T, 1>(size, rows) {}
+    DynamicContainer2D(Index size, Index rows, const FieldAllocator &allocator = FieldAllocator{})
+        : DC2D(size, rows, allocator) {}
 
     T &operator()(Index l, Index i)
     {
         assert(l < this->size_ && i < this->rows_);
-        return this->data_[l * this->rows_ + i];
+        return this->data_[this->offset(l, i)];
     }
 
     const T &operator()(Index l, Index i) const
     {
         assert(l < this->size_ && i < this->rows_);
-        return this->data_[l * this->rows_ + i];
+        return this->data_[this->offset(l, i)];
     }
 
     using DC2D::rows;
     using DC2D::size;
 
+    /*Calls f(l, i) for all variables l and rows i, in the order the values are stored. Loops written this way
+    run over contiguous memory, and vectorize across variables, for all layouts*/
+    template <typename Function>
+    void for_all_in_memory_order(Function &&f) const
+    {
+        Layout::for_range_in_memory_order(0, size(), size(), rows(), f);
+    }
+
+    /*As for_all_in_memory_order, for the variables [first, last) only*/
+    template <typename Function>
+    void for_range_in_memory_order(Index first, Index last, Function &&f) const
+    {
+        assert(first <= last && last <= size());
+        Layout::for_range_in_memory_order(first, last, size(), rows(), f);
+    }
+
     string to_string() const
     {
         std::stringstream ss;
@@ -0,0 +1,47 @@
+#pragma once
+#include "../Includes.hpp"
+#include "../ThreadPool.hpp"
+#include <cstdlib>
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/*Allocation of the storage of the dynamic containers. The storage is aligned to a cache line, which covers all
+SIMD register widths. With huge_pages, storage of at least one huge page is aligned to a huge page and the kernel
+is advised to back it with transparent huge pages (Linux only, ignored elsewhere).
+Zeroing the storage, which decides on which NUMA node the pages are placed, is done by the containers, on the
+threads of thread_pool if given*/
+struct FieldAllocator
+{
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    bool huge_pages{false};
+    ThreadPool *thread_pool{nullptr};
+
+    void *allocate(size_t n_bytes) const
+    {
+        const bool use_huge_pages = huge_pages && n_bytes >= HUGE_PAGE_SIZE;
+        const size_t alignment = use_huge_pages ? HUGE_PAGE_SIZE : ALIGNMENT;
+
+        /*std::aligned_alloc requires the size to be a multiple of the alignment*/
+        const size_t n_allocated = (max(n_bytes, size_t(1)) + alignment - 1) / alignment * alignment;
+
+        void *ptr = std::aligned_alloc(alignment, n_allocated);
+        if (!ptr)
+            throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+        static bool warned{false};
+        if (use_huge_pages && madvise(ptr, n_allocated, MADV_HUGEPAGE) != 0 && !warned)
+        {
+            cout << "Warning: transparent huge pages are not available, using regular pages\n";
+            warned = true;
+        }
+#endif
+        return ptr;
+    }
+
+    static void deallocate(void *ptr) { std::free(ptr); }
+};
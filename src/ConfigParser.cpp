@@ -1,4 +1,5 @@
 #include "../include/ConfigParser.hpp"
+#include <cstdlib>
 
 ConfigParser::ConfigParser(const string &sim_dir) : sim_dir_path{sim_dir}
 {
@@ -43,6 +44,13 @@ void ConfigParser::parse_yaml_file_options(Config &config)
 
     config.main_solver_type = read_required_enum_option<MainSolverType>("solver", main_solver_from_string);
 
+    if (config.main_solver_type == MainSolverType::NavierStokes)
+    {
+        config.dynamic_viscosity = read_optional_option<Scalar>("dynamic_viscosity", standard_air::dynamic_viscosity);
+
+        config.prandtl_number = read_optional_option<Scalar>("prandtl_number", standard_air::prandtl_number);
+    }
+
     config.time_scheme = read_required_enum_option<TimeScheme>("time_scheme", time_scheme_from_string);
 
     config.inv_flux_scheme = read_required_enum_option<InviscidFluxScheme>("inviscid_flux_scheme", inviscid_flux_scheme_from_string);
@@ -52,10 +60,62 @@ void ConfigParser::parse_yaml_file_options(Config &config)
     if (config.spatial_order == SpatialOrder::Second)
     {
         config.limiter = read_required_enum_option<Limiter>("limiter", limiter_from_string);
+
+        config.venkatakrishnan_K = read_optional_option<Scalar>("venkatakrishnan_K", 5.0);
+
+        config.freeze_limiter_timestep = read_optional_option<size_t>("freeze_limiter_timestep", 0);
+
+        config.freeze_limiter_residual_drop = read_optional_option<Scalar>("freeze_limiter_residual_drop", 0.0);
+
+        config.limiter_shock_sensor = read_optional_option<bool>("limiter_shock_sensor", false);
+
+        config.shock_sensor_threshold = read_optional_option<Scalar>("shock_sensor_threshold", 0.02);
     }
 
+    config.math_kernels = read_optional_enum_option<MathKernels>("math_kernels", math_kernels_from_string, MathKernels::Exact);
+
+    if (config.math_kernels == MathKernels::Fast)
+        config.fast_math_tolerance = read_optional_option<Scalar>("fast_math_tolerance", 1e-5);
+
     config.grad_scheme = read_optional_enum_option<GradientScheme>("grad_scheme", gradient_scheme_from_string, GradientScheme::GreenGauss);
 
+    config.store_ghost_cells = read_optional_option<bool>("store_ghost_cells", true);
+
+    config.huge_pages = read_optional_option<bool>("huge_pages", false);
+
+    config.face_tile_size_kb = read_optional_option<size_t>("face_tile_size_kb", 0);
+
+    config.temporal_block_size_kb = read_optional_option<size_t>("temporal_block_size_kb", 0);
+
+    config.task_partitions = read_optional_option<Index>("task_partitions", 0);
+
+    config.activity_tolerance = read_optional_option<Scalar>("activity_tolerance", 0.0);
+
+    if (config.activity_tolerance > 0.0)
+    {
+        config.activity_halo = read_optional_option<ShortIndex>("activity_halo", 2);
+
+        config.activity_block_size = read_optional_option<Index>("activity_block_size", 1);
+
+        config.activity_full_sweep_interval = read_optional_option<size_t>("activity_full_sweep_interval", 20);
+    }
+
+    config.n_threads = read_optional_option<ShortIndex>("n_threads", 1);
+
+    config.chunk_size = read_optional_option<Index>("chunk_size", 1024);
+
+    config.deterministic_accumulation = read_optional_option<bool>("deterministic_accumulation", true);
+
+    config.thread_affinity = read_optional_enum_option<ThreadAffinity>("thread_affinity", thread_affinity_from_string, ThreadAffinity::None);
+    if (const char *affinity = std::getenv("NETFLUX_THREAD_AFFINITY"))
+        config.thread_affinity = lookup_enum_option_map(thread_affinity_from_string, affinity, "NETFLUX_THREAD_AFFINITY");
+
+    if (root_node["thread_cores"])
+        for (const auto &core : root_node["thread_cores"])
+            config.thread_cores.push_back(core.as<int>());
+    if (const char *cores = std::getenv("NETFLUX_THREAD_CORES"))
+        config.thread_cores = parse_cpu_list(cores);
+
     config.initial_cond_option = read_required_enum_option<InitialConditionOption>("initial_cond", initial_condition_option_from_string);
 
     Scalar density_fs = read_optional_option<Scalar>("density_fs", standard_air::density);
@@ -70,13 +130,19 @@ void ConfigParser::parse_yaml_file_options(Config &config)
 
     config.n_timesteps = read_required_option<size_t>("n_timesteps");
 
+    config.convergence_tolerance = read_optional_option<Scalar>("convergence_tolerance", 0.0);
+
     config.CFL = read_required_option<Scalar>("CFL");
 
+    config.local_time_stepping = read_optional_option<bool>("local_time_stepping", false);
+
     config.write_stride = read_optional_option<size_t>("write_stride", 5);
 
     config.check_if_physical = read_optional_option<bool>("check_physical_validity", false);
 
     read_patches(config);
+
+    read_passive_scalars(config);
 }
 
 void ConfigParser::infer_hidden_options(Config &config)
@@ -88,8 +154,80 @@ void ConfigParser::infer_hidden_options(Config &config)
     }
     else
     {
-        assert_msg(false, "Implicit schemes are not yet implemented\n");
+        assert(config.time_scheme == TimeScheme::LUSGS);
+        config.time_integration_type = TimeIntegrationType::Implicit;
+    }
+
+    /*The LU-SGS sweeps update all cells and leave the passive scalars alone*/
+    if (config.time_integration_type == TimeIntegrationType::Implicit &&
+        (config.activity_tolerance > 0.0 || config.get_N_PASSIVE_SCALARS() > 0))
+        throw std::runtime_error("time_scheme: LUSGS can not be combined with activity_tolerance or passive_scalars");
+
+    /*The blocked stages only see the cells of one block at a time, while the shock sensor needs all cells. The
+    limiter can not be frozen either, since the values left in the halo cells come from the stage of the
+    neighbouring block processed last*/
+    if (config.temporal_block_size_kb > 0)
+    {
+        if (config.time_scheme != TimeScheme::TVD_RK3)
+            throw std::runtime_error("temporal_block_size_kb requires time_scheme: TVD_RK3");
+        if (config.limiter_shock_sensor || config.freeze_limiter_timestep > 0 || config.freeze_limiter_residual_drop > 0.0)
+            throw std::runtime_error("temporal_block_size_kb can not be combined with limiter_shock_sensor or "
+                                     "limiter freezing");
     }
+
+    /*The face tiles are only used by the serial flux loop over all faces. The parallel face loops, the task
+    partitions, the blocked stages and the active region go through the faces in their own order*/
+    if (config.face_tile_size_kb > 0 &&
+        (config.n_threads > 1 || config.task_partitions > 0 || config.temporal_block_size_kb > 0 || config.activity_tolerance > 0.0))
+        throw std::runtime_error("face_tile_size_kb can not be combined with n_threads > 1, task_partitions, "
+                                 "temporal_block_size_kb or activity_tolerance");
+
+    /*The cells flagged by the shock sensor are collected in a single list over all cells*/
+    if (config.task_partitions > 0 && config.limiter_shock_sensor)
+        throw std::runtime_error("task_partitions can not be combined with limiter_shock_sensor");
+
+    /*The active region keeps its levels in the cell levels of the temporal blocking, and the shock sensor needs all
+    cells*/
+    if (config.activity_tolerance > 0.0)
+    {
+        if (config.temporal_block_size_kb > 0 || config.limiter_shock_sensor)
+            throw std::runtime_error("activity_tolerance can not be combined with temporal_block_size_kb or limiter_shock_sensor");
+        if (config.activity_block_size == 0 || config.activity_full_sweep_interval == 0)
+            throw std::runtime_error("activity_block_size and activity_full_sweep_interval must be at least 1");
+    }
+
+    /*The third order reconstruction is meant for smooth flows and is not limited. Its stencils reach further than the
+    stage halos of the blocked stages and the active region and the neighbours of the task partitions, and the tiled
+    flux loop only reconstructs linearly*/
+    if (config.spatial_order == SpatialOrder::Third &&
+        (config.face_tile_size_kb > 0 || config.temporal_block_size_kb > 0 || config.task_partitions > 0 || config.activity_tolerance > 0.0))
+        throw std::runtime_error("spatial_order: Third can not be combined with face_tile_size_kb, temporal_block_size_kb, "
+                                 "task_partitions or activity_tolerance");
+
+    /*The viscous fluxes take the face gradients from the gradients of the reconstruction, and are added in the
+    untiled face loops*/
+    if (config.main_solver_type == MainSolverType::NavierStokes)
+    {
+        if (config.spatial_order == SpatialOrder::First)
+            throw std::runtime_error("solver: NavierStokes requires spatial_order: Second or Third");
+        if (config.face_tile_size_kb > 0)
+            throw std::runtime_error("solver: NavierStokes can not be combined with face_tile_size_kb");
+        if (config.dynamic_viscosity < 0.0 || config.prandtl_number <= 0.0)
+            throw std::runtime_error("dynamic_viscosity must be non-negative and prandtl_number positive");
+    }
+
+    /*The scalar fluxes are added in the untiled face loops, and the blocked stages do not advance the scalars*/
+    if (config.get_N_PASSIVE_SCALARS() > 0 && (config.face_tile_size_kb > 0 || config.temporal_block_size_kb > 0))
+        throw std::runtime_error("passive_scalars can not be combined with face_tile_size_kb or temporal_block_size_kb");
+
+    if (config.convergence_tolerance < 0.0)
+        throw std::runtime_error("convergence_tolerance must be non-negative");
+
+    if (config.n_threads == 0 || config.chunk_size == 0)
+        throw std::runtime_error("n_threads and chunk_size must be at least 1");
+
+    if (config.thread_affinity == ThreadAffinity::List && config.thread_cores.size() < config.n_threads)
+        throw std::runtime_error("thread_affinity: List requires thread_cores with a core for each of the n_threads threads");
 }
 
 void ConfigParser::read_patches(Config &config)
@@ -127,6 +265,36 @@ void ConfigParser::read_patches(Config &config)
     }
 }
 
+/*Each entry is a map with the name of the scalar and optionally its initial_value (default 0) and
+freestream_value (default the initial value)*/
+void ConfigParser::read_passive_scalars(Config &config)
+{
+    if (!root_node["passive_scalars"])
+        return;
+
+    YAML::Node scalars_node = root_node["passive_scalars"];
+
+    if (!scalars_node.IsSequence())
+        throw std::runtime_error("\"passive_scalars\" setting in configuration file is not a valid sequence");
+
+    for (const auto &scalar_node : scalars_node)
+    {
+        if (!scalar_node.IsMap() || !scalar_node["name"])
+            throw std::runtime_error("Entry in \"passive_scalars\" setting in configuration file has no name");
+
+        const string name = scalar_node["name"].as<string>();
+        if (std::find(config.passive_scalar_names.begin(), config.passive_scalar_names.end(), name) != config.passive_scalar_names.end())
+            throw std::runtime_error("Duplicate passive scalar name \"" + name + "\" specified in config file");
+
+        const Scalar initial_value = scalar_node["initial_value"] ? scalar_node["initial_value"].as<Scalar>() : 0.0;
+        const Scalar freestream_value = scalar_node["freestream_value"] ? scalar_node["freestream_value"].as<Scalar>() : initial_value;
+
+        config.passive_scalar_names.push_back(name);
+        config.passive_scalar_initial_values.push_back(initial_value);
+        config.passive_scalar_freestream_values.push_back(freestream_value);
+    }
+}
+
 /*Scans the sim-dir and sets the name of a valid mesh if such a file is found*/
 void ConfigParser::set_mesh_name(Config &config)
 {
@@ -3,18 +3,29 @@
 Driver::Driver(Config &config) : config{config}
 {
 
-    grid = std::make_unique<geom::Grid>(config);
+    if (config.get_math_kernels() == MathKernels::Fast)
+        config.set_fast_math_iterations(fast_math::select_newton_iterations(config.get_fast_math_tolerance()));
+
+    thread_pool = make_unique<ThreadPool>(config.get_n_threads(), config.get_chunk_size(),
+                                          ThreadPool::select_worker_cores(config.get_thread_affinity(), config.get_thread_cores(),
+                                                                          config.get_n_threads()));
+
+    grid = std::make_unique<geom::Grid>(config, *thread_pool);
+    thread_pool->print_placement(config.get_N_INTERIOR_CELLS());
 
     switch (config.get_main_solver_type())
     {
     case MainSolverType::Euler:
-        solvers.push_back(make_unique<EulerSolver>(config, *grid));
+        solvers.push_back(EulerSolver::create(config, *grid, *thread_pool));
+        break;
+    case MainSolverType::NavierStokes:
+        solvers.push_back(NS_Solver::create(config, *grid, *thread_pool));
         break;
     default:
         throw std::runtime_error("Error: Illegal solver type specified");
     }
 
-    output = make_unique<Output>(*grid, solvers, config);
+    output = make_unique<Output>(*grid, solvers, config, *thread_pool);
 }
 
 void Driver::solve()
@@ -30,11 +41,10 @@ void Driver::solve()
     {
         /*If main solvers consisting of multiple sub-solvers (for instance NS + scalar transport) are implemented in the future,
         additional constructs should be added to handle the sequential solution of those. This is ignored for now. It is
-        assumed that there is only one solver*/
+        assumed that there is only one solver. Passive scalars are not separate solvers, they are advanced within the
+        steps of the main solver and share its face loops, see PassiveScalarData*/
         assert(solvers.size() == 1);
 
-        solvers.at(0)->calc_timestep(config);
-
         for (auto &solver : solvers)
         {
             solver->step(config);
@@ -44,16 +54,37 @@ void Driver::solve()
 
         config.set_time(config.get_time() + config.get_delta_time());
 
-        cout << "Time step " << config.get_timestep() << " finished\n";
+        cout << "Time step " << config.get_timestep() << " finished";
+        if (solvers[0]->has_current_residual_norms())
+            cout << ", L2 density residual " << solvers[0]->get_residual_norms().L2[0];
+        cout << "\n";
 
+        output->write_residual_history(config);
         output->write_vtk_ascii(config);
 
         if (config.get_timestep() >= config.get_n_timesteps())
         {
             break;
         }
+
+        if (residual_converged())
+        {
+            cout << "Residual dropped by " << config.get_convergence_tolerance() << " orders of magnitude after "
+                 << config.get_timestep() << " time steps\n";
+            output->write_final_vtk_ascii(config);
+            break;
+        }
     }
 
     cout << "Solver finished\n";
     cout << "Elapsed time: " << config.get_elapsed_time() << endl;
-}
\ No newline at end of file
+    for (const auto &solver : solvers)
+        solver->print_phase_timings();
+    thread_pool->print_statistics();
+}
+
+bool Driver::residual_converged()
+{
+    const Scalar tolerance = config.get_convergence_tolerance();
+    return tolerance > 0.0 && config.get_timestep() > 1 && solvers[0]->residual_dropped(tolerance);
+}
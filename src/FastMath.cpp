@@ -0,0 +1,65 @@
+#include "../include/FastMath.hpp"
+
+namespace fast_math
+{
+    namespace
+    {
+        /*Arguments are sampled geometrically over a range covering face areas, densities, pressures and the
+        intermediate quantities of the boundary conditions. The ratio is not a power of two, so that the samples
+        sweep through all mantissas, where the error of the bit pattern estimate varies*/
+        constexpr Scalar SAMPLE_MIN{1e-12};
+        constexpr Scalar SAMPLE_MAX{1e12};
+        constexpr Scalar SAMPLE_RATIO{1.0001};
+
+        template <typename FastKernel, typename ExactKernel>
+        Scalar max_relative_error(FastKernel &&fast_kernel, ExactKernel &&exact_kernel)
+        {
+            Scalar max_error{0.0};
+            for (Scalar x{SAMPLE_MIN}; x < SAMPLE_MAX; x *= SAMPLE_RATIO)
+            {
+                const Scalar exact = exact_kernel(x);
+                max_error = max(max_error, std::abs(fast_kernel(x) - exact) / exact);
+            }
+            return max_error;
+        }
+
+        template <ShortIndex N_ITER>
+        Scalar max_relative_error_all_kernels()
+        {
+            const Scalar errors[] = {
+                max_relative_error(rsqrt<N_ITER>, rsqrt<0>),
+                max_relative_error(sqrt<N_ITER>, sqrt<0>),
+                max_relative_error(pow_minus_gamma<N_ITER>, pow_minus_gamma<0>),
+                max_relative_error(pow_inv_gamma_minus_one<N_ITER>, pow_inv_gamma_minus_one<0>)};
+            return *std::max_element(std::begin(errors), std::end(errors));
+        }
+
+        Scalar max_relative_error_all_kernels(ShortIndex n_iter)
+        {
+            switch (n_iter)
+            {
+            case 2:
+                return max_relative_error_all_kernels<2>();
+            case 3:
+                return max_relative_error_all_kernels<3>();
+            default:
+                assert(false);
+                return 0.0;
+            }
+        }
+    }
+
+    ShortIndex select_newton_iterations(Scalar tolerance)
+    {
+        cout << "Validating fast math kernels against tolerance " << tolerance << "\n";
+        for (ShortIndex n_iter : newton_iteration_levels)
+        {
+            const Scalar error = max_relative_error_all_kernels(n_iter);
+            cout << "    " << n_iter << " Newton iterations: max relative error " << error << "\n";
+            if (error <= tolerance)
+                return n_iter;
+        }
+        throw std::runtime_error("The fast math kernels can not meet fast_math_tolerance, "
+                                 "use math_kernels: Exact or a larger tolerance");
+    }
+}
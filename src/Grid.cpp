@@ -2,7 +2,8 @@
 
 using namespace geom;
 
-Grid::Grid(Config &config)
+Grid::Grid(Config &config, ThreadPool &thread_pool)
+    : thread_pool{thread_pool}
 {
     read_mesh(config);
 
@@ -339,6 +340,22 @@ void Grid::create_grid(Config &config)
     cout << "Reorder faces..\n";
     reorder_faces(config);
 
+    /*--------------------------------------------------------------------
+    Create the cell to face adjacency used by the cell based loops
+    --------------------------------------------------------------------*/
+    create_cell_connectivity(config);
+
+    if (config.get_spatial_order() == SpatialOrder::Second && config.get_grad_scheme() == GradientScheme::LeastSquares)
+    {
+        cout << "Calculate least squares gradient weights..\n";
+        calc_least_squares_weights(config);
+    }
+    else if (config.get_spatial_order() == SpatialOrder::Third)
+    {
+        cout << "Calculate k-exact reconstruction stencils..\n";
+        calc_kexact_stencils(config);
+    }
+
     /*--------------------------------------------------------------------
     Reducing allocated memory
     --------------------------------------------------------------------*/
@@ -437,6 +454,200 @@ void Grid::reorder_faces(const Config &config)
     }
 }
 
+void Grid::create_cell_connectivity(const Config &config)
+{
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const Index N_TOTAL_FACES = config.get_N_TOTAL_FACES();
+
+    Vector<Index> &offsets = cell_connectivity.offsets;
+    Vector<Index> &face_indices = cell_connectivity.face_indices;
+    Vector<Index> &neighbours = cell_connectivity.neighbours;
+
+    /*Count the faces of each cell and store the counts shifted by one, so that a prefix sum gives the offsets*/
+    offsets.assign(N_INTERIOR_CELLS + 1, 0);
+    for (Index ij{0}; ij < N_TOTAL_FACES; ij++)
+    {
+        offsets[faces[ij].i + 1]++;
+        if (faces[ij].j < N_INTERIOR_CELLS)
+            offsets[faces[ij].j + 1]++;
+    }
+    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+        offsets[i + 1] += offsets[i];
+
+    face_indices.resize(offsets[N_INTERIOR_CELLS]);
+    neighbours.resize(offsets[N_INTERIOR_CELLS]);
+
+    /*Filling in face order, so that the faces of each cell end up sorted*/
+    Vector<Index> next(offsets.begin(), offsets.end() - 1);
+    for (Index ij{0}; ij < N_TOTAL_FACES; ij++)
+    {
+        Index i = faces[ij].i;
+        Index j = faces[ij].j;
+
+        face_indices[next[i]] = ij;
+        neighbours[next[i]++] = j;
+
+        if (j < N_INTERIOR_CELLS)
+        {
+            face_indices[next[j]] = ij;
+            neighbours[next[j]++] = i;
+        }
+    }
+    assert(offsets[N_INTERIOR_CELLS] == 2 * config.get_N_INTERIOR_FACES() + config.get_N_BOUNDARY_FACES());
+}
+
+void Grid::calc_least_squares_weights(const Config &config)
+{
+    /*The inverse distance weighted least squares gradient of cell i minimizes
+    sum_j (V_j - V_i - grad_i * d_ij)^2 / |d_ij|^2, where d_ij = x_j - x_i. The solution is
+    grad_i = sum_j (V_j - V_i) w_ij^T, with w_ij = M_i^-1 * d_ij / |d_ij|^2 and M_i = sum_j d_ij d_ij^T / |d_ij|^2.
+    The weights w_ij only depend on the geometry, so they are computed once here*/
+    using Mat3 = Eigen::Matrix<Scalar, N_DIM, N_DIM>;
+
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    least_squares_weights.resize(cell_connectivity.neighbours.size());
+
+    thread_pool.parallel_for(0, N_INTERIOR_CELLS, [&](Index i)
+                             {
+        Mat3 M = Mat3::Zero();
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+        {
+            Vec3 d_ij = cells[cell_connectivity.neighbours[k]].centroid - cells[i].centroid;
+            M += d_ij * d_ij.transpose() / d_ij.squaredNorm();
+        }
+
+        Mat3 M_inv;
+        bool invertible;
+        M.computeInverseWithCheck(M_inv, invertible);
+        if (!invertible)
+            throw std::runtime_error("Singular least squares matrix in cell " + std::to_string(i));
+
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+        {
+            Vec3 d_ij = cells[cell_connectivity.neighbours[k]].centroid - cells[i].centroid;
+            least_squares_weights[k] = (M_inv * d_ij / d_ij.squaredNorm()).cast<StorageScalar>();
+        } });
+}
+
+void Grid::calc_kexact_stencils(const Config &config)
+{
+    /*The quadratic reconstruction of cell i is the polynomial
+    p_i(x) = V_i + grad_i * d + hessian_i * (m(d) - m_i), with d = x - x_i and m = quadratic_monomials,
+    where m_i is the mean of m(x - x_i) over cell i, so that the mean of p_i over cell i is V_i. The mean of p_i
+    over cell j of the stencil is V_i + grad_i * d_ij + hessian_i * (m(d_ij) + m_j - m_i), the k-exact condition
+    being that this equals V_j. The derivatives c_i = [grad_i, hessian_i] minimize the inverse distance weighted
+    sum_j (V_j - V_i - c_i * phi_ij)^2 / |d_ij|^2, phi_ij = [d_ij, m(d_ij) + m_j - m_i], which gives
+    c_i = sum_j (V_j - V_i) w_ij^T with w_ij = A_i^-1 * phi_ij / |d_ij|^2 and A_i = sum_j phi_ij phi_ij^T / |d_ij|^2.
+    The system is scaled by the cell size before it is solved. A ghost cell is the point reflection of its domain
+    cell, so it has the moments of that cell*/
+    using KExactVec = Eigen::Vector<Scalar, N_KEXACT_COEFFS>;
+    using KExactMat = Eigen::Matrix<Scalar, N_KEXACT_COEFFS, N_KEXACT_COEFFS>;
+
+    /*Whole layers of face neighbours are added until the stencil has this many cells, twice the number of
+    fitted derivatives for a well conditioned fit*/
+    constexpr Index MIN_STENCIL_SIZE = 2 * N_KEXACT_COEFFS;
+
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    Vector<Index> &offsets = kexact_stencils.offsets;
+    Vector<Index> &outer_cells = kexact_stencils.outer_cells;
+
+    kexact_stencils.moments.resize(N_INTERIOR_CELLS);
+    thread_pool.parallel_for(0, N_INTERIOR_CELLS, [&](Index i)
+                             { kexact_stencils.moments[i] = tet_from_connect(tet_connect[i]).calc_second_moments().cast<StorageScalar>(); });
+
+    /*Serial, since the outer cells of all cells are stored in one list*/
+    Vector<uint8_t> in_stencil(N_INTERIOR_CELLS, 0);
+    offsets.assign(N_INTERIOR_CELLS + 1, 0);
+    outer_cells.clear();
+    size_t max_layers{1};
+    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+    {
+        in_stencil[i] = 1;
+        Vector<Index> layer;
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            if (cell_connectivity.neighbours[k] < N_INTERIOR_CELLS)
+            {
+                layer.push_back(cell_connectivity.neighbours[k]);
+                in_stencil[cell_connectivity.neighbours[k]] = 1;
+            }
+
+        Index stencil_size = cell_connectivity.end(i) - cell_connectivity.begin(i);
+        size_t n_layers{1};
+        while (stencil_size < MIN_STENCIL_SIZE && !layer.empty())
+        {
+            Vector<Index> next_layer;
+            for (Index j : layer)
+                for (Index k{cell_connectivity.begin(j)}; k < cell_connectivity.end(j); k++)
+                {
+                    const Index l = cell_connectivity.neighbours[k];
+                    if (l < N_INTERIOR_CELLS && !in_stencil[l])
+                    {
+                        in_stencil[l] = 1;
+                        next_layer.push_back(l);
+                        outer_cells.push_back(l);
+                    }
+                }
+            stencil_size += next_layer.size();
+            layer = move(next_layer);
+            n_layers++;
+        }
+        max_layers = std::max(max_layers, n_layers);
+        offsets[i + 1] = outer_cells.size();
+
+        in_stencil[i] = 0;
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            if (cell_connectivity.neighbours[k] < N_INTERIOR_CELLS)
+                in_stencil[cell_connectivity.neighbours[k]] = 0;
+        for (Index s{offsets[i]}; s < offsets[i + 1]; s++)
+            in_stencil[outer_cells[s]] = 0;
+    }
+
+    kexact_stencils.weights.resize(cell_connectivity.neighbours.size() + outer_cells.size());
+
+    thread_pool.parallel_for(0, N_INTERIOR_CELLS, [&](Index i)
+                             {
+        const Vec3 &x_i = cells[i].centroid;
+        const QuadraticVec m_i = kexact_stencils.moments[i].cast<Scalar>();
+        const Scalar h = cbrt(cells[i].cell_volume);
+
+        /*Scaled stencil vectors D^-1 * phi_ij, where D scales the derivatives to a cell of unit size*/
+        Vector<Index> stencil_cells;
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            stencil_cells.push_back(cell_connectivity.neighbours[k]);
+        for (Index s{offsets[i]}; s < offsets[i + 1]; s++)
+            stencil_cells.push_back(outer_cells[s]);
+
+        Vector<KExactVec> phi(stencil_cells.size());
+        Vector<Scalar> inv_distance_sq(stencil_cells.size());
+        KExactMat A = KExactMat::Zero();
+        for (Index s{0}; s < stencil_cells.size(); s++)
+        {
+            const Index j = stencil_cells[s];
+            const Vec3 d_ij = cells[j].centroid - x_i;
+            const QuadraticVec m_j = j < N_INTERIOR_CELLS ? kexact_stencils.moments[j].cast<Scalar>() : m_i; // Ghost cells of i
+            phi[s] << d_ij / h, (quadratic_monomials(d_ij) + m_j - m_i) / (h * h);
+            inv_distance_sq[s] = h * h / d_ij.squaredNorm();
+            A += inv_distance_sq[s] * phi[s] * phi[s].transpose();
+        }
+
+        const Eigen::FullPivLU<KExactMat> lu{A};
+        if (!lu.isInvertible())
+            throw std::runtime_error("Singular k-exact reconstruction matrix in cell " + std::to_string(i));
+
+        KExactVec scale;
+        scale << KExactVec::Constant(1 / h).head<N_DIM>(), KExactVec::Constant(1 / (h * h)).tail<N_HESSIAN>();
+
+        const Index first_weight = kexact_stencils.begin_weights(i, cell_connectivity);
+        for (Index s{0}; s < stencil_cells.size(); s++)
+            kexact_stencils.weights[first_weight + s] =
+                scale.cwiseProduct(lu.solve(inv_distance_sq[s] * phi[s])).cast<StorageScalar>(); });
+
+    cout << "K-exact stencils: " << std::fixed << std::setprecision(1)
+         << static_cast<Scalar>(kexact_stencils.weights.size()) / std::max<Index>(N_INTERIOR_CELLS, 1)
+         << " cells per stencil on average, at most " << max_layers << " layers\n"
+         << std::defaultfloat << std::setprecision(6);
+}
+
 // std::pair<Index, bool> Grid::find_neigbouring_cell(Index i,
 //                                                    TriConnect face_ij,
 //                                                    const Vector<TetConnect> &tet_connect) const
@@ -518,6 +729,14 @@ void Grid::shrink_vectors()
     cells.shrink_to_fit();
     faces.shrink_to_fit();
     patches.shrink_to_fit();
+    cell_connectivity.offsets.shrink_to_fit();
+    cell_connectivity.face_indices.shrink_to_fit();
+    cell_connectivity.neighbours.shrink_to_fit();
+    least_squares_weights.shrink_to_fit();
+    kexact_stencils.offsets.shrink_to_fit();
+    kexact_stencils.outer_cells.shrink_to_fit();
+    kexact_stencils.weights.shrink_to_fit();
+    kexact_stencils.moments.shrink_to_fit();
 }
 
 void Grid::print_grid(const Config &config) const
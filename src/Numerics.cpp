@@ -1,25 +1,10 @@
 
 #include "../include/Numerics.hpp"
 
-NumericalFlux::InvFluxFunction NumericalFlux::get_inviscid_flux_function(InviscidFluxScheme inv_flux_scheme)
-{
-    assert(inv_flux_functions.count(inv_flux_scheme) == 1);
-    return inv_flux_functions.at(inv_flux_scheme);
-}
-
-void NumericalFlux::rusanov(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux)
-{
-    Vec3 normal = S_ij.normalized();
-    Scalar area = S_ij.norm();
-    Scalar spec_rad_L = EulerEqs::conv_spectral_radii(U_L, normal);
-    Scalar spec_rad_R = EulerEqs::conv_spectral_radii(U_R, normal);
-
-    Flux = area * 0.5 * (EulerEqs::inviscid_flux(U_R, normal) + EulerEqs::inviscid_flux(U_L, normal) - std::max(spec_rad_R, spec_rad_L) * (U_R - U_L));
-}
-
-void NumericalFlux::HLLC(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux)
+Scalar NumericalFlux::HLLC(const EulerVecMap &U_L, const EulerVecMap &U_R, const Vec3 &S_ij, EulerVecMap &Flux)
 {
     assert(false); // Not implemented
+    return 0.0;
 }
 
 // BoundaryCondition::BC_function BoundaryCondition::get_BC_function(BoundaryType boundary_type)
@@ -56,7 +41,7 @@ void NumericalFlux::HLLC(const EulerVecMap &U_L, const EulerVecMap &U_R, const V
 //     assert(false); // not implemented
 // }
 
-void BC_NoSlipWall::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij)
+void BC_NoSlipWall::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const
 {
     V_ghost[0] = V_domain[0];
     V_ghost[1] = -V_domain[1];
@@ -65,11 +50,11 @@ void BC_NoSlipWall::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_g
     V_ghost[4] = V_domain[4];
 }
 
-void BC_SlipWall::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij)
+void BC_SlipWall::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const
 {
     // normal velocity = <velocity, normal>
-    normal = S_ij.normalized();
-    vel_normal = (V_domain[1] * normal.x() + V_domain[2] * normal.y() + V_domain[3] * normal.z());
+    const Vec3 normal = S_ij.normalized();
+    const Scalar vel_normal = (V_domain[1] * normal.x() + V_domain[2] * normal.y() + V_domain[3] * normal.z());
 
     V_ghost[0] = V_domain[0];
 
@@ -88,9 +73,29 @@ BC_FarField::BC_FarField(const Config &config)
     pressure_fs = V_fs[4];
     c_fs = EulerEqs::sound_speed_primitive(V_fs);
     entropy_fs = EulerEqs::entropy_primitive(V_fs);
+    math_iterations = config.get_fast_math_iterations();
 }
 
-void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij)
+void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const
+{
+    switch (math_iterations)
+    {
+    case 0:
+        calc_ghost_val_kernels<0>(V_domain, V_ghost, S_ij);
+        break;
+    case 2:
+        calc_ghost_val_kernels<2>(V_domain, V_ghost, S_ij);
+        break;
+    case 3:
+        calc_ghost_val_kernels<3>(V_domain, V_ghost, S_ij);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+template <ShortIndex MATH_ITER>
+void BC_FarField::calc_ghost_val_kernels(const EulerVecMap &V_domain, EulerVecMap &V_ghost, const Vec3 &S_ij) const
 {
     /*
     Model convention used:
@@ -107,11 +112,13 @@ void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_gho
     Now an eigenvalue > 0 corresponds to a wave going out of the domain
     and a value < 0 goes into the domain */
 
-    normal = S_ij.normalized();
-    vel_domain = {V_domain[1], V_domain[2], V_domain[3]};
-    vel_n_fs = normal.dot(vel_fs);
-    vel_n_domain = normal.dot(vel_domain);
-    c_domain = EulerEqs::sound_speed_primitive(V_domain);
+    const Vec3 normal = S_ij.normalized();
+    const Vec3 vel_domain = {V_domain[1], V_domain[2], V_domain[3]};
+    const Scalar vel_n_fs = normal.dot(vel_fs);
+    const Scalar vel_n_domain = normal.dot(vel_domain);
+    const Scalar c_domain = EulerEqs::sound_speed_primitive<MATH_ITER>(V_domain);
+
+    Scalar Riemann_plus, Riemann_minus;
 
     if (vel_n_fs + c_fs > 0.0) // Subsonic inflow or sub/super-sonic outflow
     {
@@ -132,13 +139,16 @@ void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_gho
     }
 
     /*Compute normal velocity sound speed at the boundary from riemann invariants*/
-    vel_n_boundary = 0.5 * (Riemann_plus + Riemann_minus);
-    c_boundary = EulerEqs::GAMMA_MINUS_ONE / 4 * (Riemann_plus - Riemann_minus);
+    const Scalar vel_n_boundary = 0.5 * (Riemann_plus + Riemann_minus);
+    const Scalar c_boundary = EulerEqs::GAMMA_MINUS_ONE / 4 * (Riemann_plus - Riemann_minus);
+
+    Vec3 vel_boundary;
+    Scalar entropy_boundary;
 
     if (vel_n_fs > 0.0) // Take tangential velocity and entropy from the domain
     {
         vel_boundary = vel_domain + (vel_n_boundary - vel_n_domain) * normal;
-        entropy_boundary = EulerEqs::entropy_primitive(V_domain);
+        entropy_boundary = EulerEqs::entropy_primitive<MATH_ITER>(V_domain);
     }
     else // Take tangential velocity and entropy from the freestream
     {
@@ -146,8 +156,8 @@ void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_gho
         entropy_boundary = entropy_fs;
     }
 
-    density_boundary = pow(EulerEqs::GAMMA * entropy_boundary / (c_boundary * c_boundary), EulerEqs::GAMMA_MINUS_ONE_INV);
-    pressure_boundary = c_boundary * c_boundary * density_boundary / EulerEqs::GAMMA;
+    const Scalar density_boundary = fast_math::pow_inv_gamma_minus_one<MATH_ITER>(EulerEqs::GAMMA * entropy_boundary / (c_boundary * c_boundary));
+    const Scalar pressure_boundary = c_boundary * c_boundary * density_boundary / EulerEqs::GAMMA;
 
     // Assign values to ghost cells. Constant extrapolation
     V_ghost[0] = density_boundary;
@@ -156,7 +166,10 @@ void BC_FarField::calc_ghost_val(const EulerVecMap &V_domain, EulerVecMap &V_gho
     V_ghost[3] = vel_boundary.z();
     V_ghost[4] = pressure_boundary;
 
-#ifndef NDEBUG // just double checking implementation
+#ifndef NDEBUG // just double checking implementation, the fast math kernels are checked at startup instead
+    if constexpr (MATH_ITER > 0)
+        return;
+
     if (vel_n_fs + c_fs < 0.0)
     { // supersonic inflow, all values should now come from freestream
         assert(is_approx_equal(V_ghost[0], density_fs));
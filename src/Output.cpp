@@ -1,8 +1,8 @@
 
 #include "../include/Output.hpp"
 
-Output::Output(const geom::Grid &grid, const Vector<unique_ptr<Solver>> &solvers, const Config &config)
-    : grid{grid}, solvers{solvers}
+Output::Output(const geom::Grid &grid, const Vector<unique_ptr<Solver>> &solvers, const Config &config, ThreadPool &thread_pool)
+    : grid{grid}, solvers{solvers}, thread_pool{thread_pool}
 {
     string output_dir = config.get_output_dir();
 
@@ -12,6 +12,20 @@ Output::Output(const geom::Grid &grid, const Vector<unique_ptr<Solver>> &solvers
 
     if (!filesys::create_directory(output_dir))
         throw std::runtime_error("Couldn't create output directory: " + output_dir);
+
+    const string residual_filename = output_dir + "residual_history.csv";
+    residual_history.open(residual_filename);
+    FAIL_IF_MSG(!residual_history, "Couldn't open file " + residual_filename);
+
+    residual_history << "timestep,time";
+    for (const char *norm : {"L2", "Linf"})
+        for ([[maybe_unused]] const auto &solver : solvers)
+        {
+            assert(solver->get_solver_type() == SolverType::Euler || solver->get_solver_type() == SolverType::NavierStokes);
+            for (const char *name : EulerOutput::conservative_variable_names)
+                residual_history << "," << norm << "_" << name;
+        }
+    residual_history << "\n";
 }
 
 void Output::write_vtk_ascii(const Config &config, bool write_grid_only)
@@ -20,6 +34,33 @@ void Output::write_vtk_ascii(const Config &config, bool write_grid_only)
     if (config.get_timestep() % config.get_write_stride() != 0)
         return;
 
+    write_vtk_ascii_files(config, write_grid_only);
+}
+
+void Output::write_final_vtk_ascii(const Config &config)
+{
+    if (config.get_timestep() % config.get_write_stride() != 0)
+        write_vtk_ascii_files(config, false);
+}
+
+void Output::write_residual_history(const Config &config)
+{
+    for (const auto &solver : solvers)
+        if (!solver->has_current_residual_norms())
+            return;
+
+    residual_history << config.get_timestep() << "," << config.get_time();
+    for (const auto &solver : solvers)
+        for (Scalar norm : solver->get_residual_norms().L2)
+            residual_history << "," << norm;
+    for (const auto &solver : solvers)
+        for (Scalar norm : solver->get_residual_norms().Linf)
+            residual_history << "," << norm;
+    residual_history << std::endl; // Flushed, so that the history can be followed during the run
+}
+
+void Output::write_vtk_ascii_files(const Config &config, bool write_grid_only)
+{
     const string &filename = config.get_unsteady_vtk_filename();
 
     write_vtk_ascii_grid(config, filename);
@@ -34,8 +75,11 @@ void Output::write_vtk_ascii(const Config &config, bool write_grid_only)
             switch (solver->get_solver_type())
             {
             case SolverType::Euler:
+            case SolverType::NavierStokes:
             {
-                EulerOutput::write_vtk_ascii_cell_data(config, filename, consvars);
+                EulerOutput::write_vtk_ascii_cell_data(config, filename, consvars, thread_pool);
+                if (const PassiveScalarData *passive_scalars = solver->get_passive_scalars())
+                    PassiveScalarOutput::write_vtk_ascii_cell_data(config, filename, consvars, *passive_scalars, thread_pool);
                 break;
             }
             default:
@@ -63,19 +107,22 @@ void Output::write_vtk_ascii_grid(const Config &config, string filename)
         << "POINTS " << N_NODES << " " + string(Scalar_name) + "\n";
 
     /*Writing the grid*/
-    for (const auto &node : nodes)
-        ost << node.x() << " " << node.y() << " " << node.z() << "\n";
+    write_lines(ost, N_NODES, thread_pool, [&](std::ostream &line_ost, Index i)
+                { line_ost << nodes[i].x() << " " << nodes[i].y() << " " << nodes[i].z() << "\n"; });
 
     ost << "\nCELLS " << N_TETS << " " << (1 + N_TET_FACES) * N_TETS << "\n";
-    for (const auto &tc : tet_connectivity)
-        ost << N_TET_FACES << " " << tc.a() << " " << tc.b() << " " << tc.c() << " " << tc.d() << "\n";
+    write_lines(ost, N_TETS, thread_pool, [&](std::ostream &line_ost, Index i)
+                {
+        const auto &tc = tet_connectivity[i];
+        line_ost << N_TET_FACES << " " << tc.a() << " " << tc.b() << " " << tc.c() << " " << tc.d() << "\n"; });
 
     ost << "\nCELL_TYPES " << N_TETS << "\n";
     for (Index i{0}; i < N_TETS; i++)
         ost << VTK_TET_TYPE << "\n";
 }
 
-void EulerOutput::write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars)
+void EulerOutput::write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars,
+                                            ThreadPool &thread_pool)
 {
 
     assert(consvars.get_N_EQS() == N_EQS_EULER);
@@ -89,20 +136,35 @@ void EulerOutput::write_vtk_ascii_cell_data(const Config &config, const string &
 
     ost << "\nSCALARS density " + string(Scalar_name) + " 1\n"
         << "LOOKUP_TABLE default\n";
-    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
-        ost << consvars(i, 0) << "\n";
+    write_lines(ost, N_INTERIOR_CELLS, thread_pool, [&](std::ostream &line_ost, Index i)
+                { line_ost << consvars(i, 0) << "\n"; });
 
     ost << "\nVECTORS velocity " + string(Scalar_name) + "\n";
-    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
-    {
-        ost << consvars(i, 1) / consvars(i, 0) << " " << consvars(i, 2) / consvars(i, 0) << " " << consvars(i, 3) / consvars(i, 0) << "\n";
-    }
+    write_lines(ost, N_INTERIOR_CELLS, thread_pool, [&](std::ostream &line_ost, Index i)
+                { line_ost << consvars(i, 1) / consvars(i, 0) << " " << consvars(i, 2) / consvars(i, 0) << " " << consvars(i, 3) / consvars(i, 0) << "\n"; });
 
     ost << "\nSCALARS pressure " + string(Scalar_name) + " 1\n"
         << "LOOKUP_TABLE default\n";
+    Vector<Scalar> pressure(N_INTERIOR_CELLS);
+    thread_pool.parallel_for_chunks(0, N_INTERIOR_CELLS, [&](Index first, Index last)
+                                    { EulerEqs::pressure(consvars, first, last, pressure.data() + first); });
+    write_lines(ost, N_INTERIOR_CELLS, thread_pool, [&](std::ostream &line_ost, Index i)
+                { line_ost << pressure[i] << "\n"; });
+}
+void PassiveScalarOutput::write_vtk_ascii_cell_data(const Config &config, const string &filename, const VecField &consvars,
+                                                    const PassiveScalarData &passive_scalars, ThreadPool &thread_pool)
+{
+    std::ofstream ost{filename, std::ios::app};
+    FAIL_IF_MSG(!ost, "Couldn't open file " + filename);
 
-    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const VecField &scalars = passive_scalars.get_solution();
+
+    for (ShortIndex k{0}; k < passive_scalars.get_N_SCALARS(); k++)
     {
-        ost << EulerEqs::pressure(consvars.get_variable<EulerVec>(i)) << "\n";
+        ost << "\nSCALARS " + config.get_passive_scalar_names()[k] + " " + string(Scalar_name) + " 1\n"
+            << "LOOKUP_TABLE default\n";
+        write_lines(ost, N_INTERIOR_CELLS, thread_pool, [&](std::ostream &line_ost, Index i)
+                    { line_ost << scalars(i, k) / consvars(i, 0) << "\n"; });
     }
-}
\ No newline at end of file
+}
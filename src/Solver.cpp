@@ -2,8 +2,8 @@
 
 using namespace geom;
 
-Solver::Solver(const geom::Grid &grid, const Config &config)
-    : grid{grid}
+Solver::Solver(const geom::Grid &grid, const Config &config, ThreadPool &thread_pool)
+    : grid{grid}, thread_pool{thread_pool}
 {
     create_BC_container(config);
 }
@@ -31,132 +31,952 @@ void Solver::create_BC_container(const Config &config)
     }
 }
 
-void Solver::step(const Config &config)
+void Solver::print_phase_timings() const
 {
+    cout << "Time spent in the " << string_from_solver_type.at(get_solver_type()) << " solver phases:\n";
+    for (const auto &[phase, stopwatch] : phase_timings)
+    {
+        cout << "    " << std::left << std::setw(24) << phase << std::right << std::setw(12) << stopwatch.get_total_seconds() << " s"
+             << std::setw(12) << 1e3 * stopwatch.get_total_seconds() / std::max<size_t>(stopwatch.get_n_calls(), 1) << " ms/call\n";
+    }
+
+    const auto flux_timing = phase_timings.find("inviscid fluxes");
+    if (flux_timing != phase_timings.end() && flux_timing->second.get_total_seconds() > 0.0)
+        cout << "Face throughput of the flux sweeps: "
+             << 1e-6 * grid.get_faces().size() * flux_timing->second.get_n_calls() / flux_timing->second.get_total_seconds()
+             << " million faces/s\n";
+}
+
+template <typename Function>
+void Solver::parallel_for_all_with_residual_norms(Function &&f)
+{
+    const VecField &R = solver_data->get_flux_balance();
+    const auto &cells = grid.get_cells();
+    const ShortIndex N_EQS = R.get_N_EQS();
+    const Index N_CELLS = R.size();
+    const Index chunk_size = thread_pool.get_chunk_size();
+    const Index n_chunks = (N_CELLS + chunk_size - 1) / chunk_size;
+    constexpr ShortIndex SCALARS_PER_CACHE_LINE = 64 / sizeof(Scalar);
+    const ShortIndex chunk_stride = (N_EQS + SCALARS_PER_CACHE_LINE - 1) / SCALARS_PER_CACHE_LINE * SCALARS_PER_CACHE_LINE;
+
+    chunk_residual_sums.assign(size_t(n_chunks) * chunk_stride, 0.0);
+    chunk_residual_max.assign(size_t(n_chunks) * chunk_stride, 0.0);
+
+    /*The chunks of the pool cover [k * chunk_size, (k + 1) * chunk_size), so each slot has a single writer*/
+    parallel_for_all_in_memory_order(R, [&](Index i, Index j)
+                                     {
+        f(i, j);
+        const Scalar r = R(i, j) / cells[i].cell_volume;
+        const size_t slot = size_t(i / chunk_size) * chunk_stride + j;
+        chunk_residual_sums[slot] += r * r;
+        chunk_residual_max[slot] = std::max(chunk_residual_max[slot], std::abs(r)); });
+
+    residual_norms.L2.assign(N_EQS, 0.0);
+    residual_norms.Linf.assign(N_EQS, 0.0);
+    for (Index chunk{0}; chunk < n_chunks; chunk++)
+        for (ShortIndex j{0}; j < N_EQS; j++)
+        {
+            residual_norms.L2[j] += chunk_residual_sums[size_t(chunk) * chunk_stride + j];
+            residual_norms.Linf[j] = std::max(residual_norms.Linf[j], chunk_residual_max[size_t(chunk) * chunk_stride + j]);
+        }
+    for (ShortIndex j{0}; j < N_EQS; j++)
+        residual_norms.L2[j] = sqrt(residual_norms.L2[j] / std::max<Index>(N_CELLS, 1));
+    residual_norms_current = true;
+    if (initial_residual_norms.L2.empty())
+        initial_residual_norms = residual_norms;
+}
+
+template <typename FluxBalanceEvaluator>
+void Solver::explicit_euler(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance)
+{
+    VecField &U = solver_data->get_solution();
+
+    assert(U.get_N_EQS() == solver_data->get_N_EQS() && solver_data->get_flux_balance().get_N_EQS() == solver_data->get_N_EQS());
+    assert(U.size() == config.get_N_INTERIOR_CELLS() && solver_data->get_flux_balance().size() == config.get_N_INTERIOR_CELLS());
+
+    /*--------------------------------------------------------------------
+     U_n+1 = U_n + dt /Omega * R(U_n)
+     where dt is the time step of the cell with local time stepping
+    --------------------------------------------------------------------*/
+
+    evaluate_flux_balance(U, std::true_type{});
+    const auto dt_over_vol = time_step_over_volume(config);
+
+    parallel_update_integrated_fields<true>([&](VecField &U, const VecField &, const VecField &R, Index i, Index j)
+                                      { U(i, j) += dt_over_vol(i) * R(i, j); });
+}
+
+template <typename FluxBalanceEvaluator>
+void Solver::TVD_RK3(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance)
+{
+    VecField &U = solver_data->get_solution();
+
+    assert(U.get_N_EQS() == solver_data->get_N_EQS() && solver_data->get_solution_old().get_N_EQS() == solver_data->get_N_EQS() &&
+           solver_data->get_flux_balance().get_N_EQS() == solver_data->get_N_EQS());
+    assert(U.size() == config.get_N_INTERIOR_CELLS() && solver_data->get_solution_old().size() == config.get_N_INTERIOR_CELLS());
+    assert(solver_data->get_flux_balance().size() == config.get_N_INTERIOR_CELLS());
+
+    /*--------------------------------------------------------------------
+    U_1 = U_n + dt /Omega * R(U_n)
+    U_2 = 3/4 * U_n + 1/4 *U_1 + 1/4 * dt / Omega * R(U_1)
+    U_n+1 = 1/3 * U_n + 2/3 * U_2 + 2/3 * dt / Omega * R(U_2)
+    --------------------------------------------------------------------*/
 
-    assert(config.get_time_integration_type() == TimeIntegrationType::Explicit); // Remove if implementing implicit
+    evaluate_flux_balance(U, std::true_type{});
+    const auto dt_over_vol = time_step_over_volume(config);
 
-    switch (config.get_time_scheme())
+    parallel_update_integrated_fields<true>([&](VecField &U, const VecField &, const VecField &R, Index i, Index j)
+                                      { U(i, j) += dt_over_vol(i) * R(i, j); });
+
+    evaluate_flux_balance(U, std::false_type{});
+    parallel_update_integrated_fields([&](VecField &U, const VecField &U_old, const VecField &R, Index i, Index j)
+                                      { U(i, j) = 3.0 / 4.0 * U_old(i, j) + 1.0 / 4.0 * U(i, j) + 1.0 / 4.0 * dt_over_vol(i) * R(i, j); });
+
+    evaluate_flux_balance(U, std::false_type{});
+    parallel_update_integrated_fields([&](VecField &U, const VecField &U_old, const VecField &R, Index i, Index j)
+                                      { U(i, j) = 1.0 / 3.0 * U_old(i, j) + 2.0 / 3.0 * U(i, j) + 2.0 / 3.0 * dt_over_vol(i) * R(i, j); });
+}
+
+template <typename FluxBalanceEvaluator, typename RegionFluxBalanceEvaluator>
+void Solver::TVD_RK3_temporal_blocking(const Config &config,
+                                       FluxBalanceEvaluator &&evaluate_flux_balance,
+                                       RegionFluxBalanceEvaluator &&evaluate_region_flux_balance)
+{
+    VecField &U = solver_data->get_solution();
+    VecField &U_old = solver_data->get_solution_old();
+    VecField &U_1 = solver_data->get_solution_stage_1();
+    VecField &U_2 = solver_data->get_solution_stage_2();
+    VecField &R = solver_data->get_flux_balance();
+    const ShortIndex N_EQS = solver_data->get_N_EQS();
+
+    assert(U_1.size() == config.get_N_INTERIOR_CELLS() && U_2.size() == config.get_N_INTERIOR_CELLS());
+
+    /*--------------------------------------------------------------------
+    Same stages as TVD_RK3, with U_1 and U_2 stored separately. U_2 is
+    computed for the block cells up to the level of the stage halo, which
+    is what the third stage of the cells of level 0 reads from
+    --------------------------------------------------------------------*/
+
+    evaluate_flux_balance(U, std::true_type{});
+    const auto dt_over_vol = time_step_over_volume(config);
+
+    parallel_for_all_with_residual_norms([&](Index i, Index j)
+                                         { U_1(i, j) = U(i, j) + dt_over_vol(i) * R(i, j); });
+
+    for (const CellBlock &block : cell_blocks)
     {
-    case TimeScheme::ExplicitEuler:
-        explicit_euler(config);
-        break;
-    case TimeScheme::TVD_RK3:
-        TVD_RK3(config);
-        break;
-    default:
-        assert(false);
+        for (ShortIndex level{0}; level < block.n_levels(); level++)
+            for (Index c{block.level_offsets[level]}; c < block.level_offsets[level + 1]; c++)
+                cell_levels[block.cells[c]] = level;
+
+        const BlockRegion stage_2_region{block, cell_levels, static_cast<ShortIndex>((block.n_levels() - 1) / 2)};
+        evaluate_region_flux_balance(U_1, stage_2_region);
+        stage_2_region.for_cells([&](Index i)
+                                 {
+            for (ShortIndex j{0}; j < N_EQS; j++)
+                U_2(i, j) = 3.0 / 4.0 * U_old(i, j) + 1.0 / 4.0 * U_1(i, j) + 1.0 / 4.0 * dt_over_vol(i) * R(i, j); });
+
+        const BlockRegion stage_3_region{block, cell_levels, 0};
+        evaluate_region_flux_balance(U_2, stage_3_region);
+        stage_3_region.for_cells([&](Index i)
+                                 {
+            for (ShortIndex j{0}; j < N_EQS; j++)
+                U(i, j) = 1.0 / 3.0 * U_old(i, j) + 2.0 / 3.0 * U_2(i, j) + 2.0 / 3.0 * dt_over_vol(i) * R(i, j); });
+
+        for (Index i : block.cells)
+            cell_levels[i] = BlockRegion::NOT_IN_BLOCK;
     }
+}
 
-    solver_data->get_solution_old() = solver_data->get_solution();
+void Solver::create_cell_blocks(const Config &config)
+{
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const ShortIndex N_EQS = solver_data->get_N_EQS();
+    const ShortIndex N_LEVELS = 2 * stage_halo_width(config) + 1;
+
+    /*Solution, old solution, the two stage solutions and the flux balance, then the primitive variables with
+    their gradient and limiter*/
+    const size_t bytes_per_cell = N_EQS * (5 * sizeof(Scalar) + (2 + N_DIM) * sizeof(StorageScalar));
+    const Index BLOCK_CELLS = std::max<Index>(1024 * config.get_temporal_block_size_kb() / bytes_per_cell, 1);
+
+    cell_levels.assign(N_INTERIOR_CELLS, BlockRegion::NOT_IN_BLOCK);
+    cell_blocks.clear();
+    size_t n_cells_with_halo{0};
+
+    for (Index first_cell{0}; first_cell < N_INTERIOR_CELLS; first_cell += BLOCK_CELLS)
+    {
+        CellBlock &block = cell_blocks.emplace_back();
+
+        block.level_offsets = {0};
+        for (Index i{first_cell}; i < std::min(first_cell + BLOCK_CELLS, N_INTERIOR_CELLS); i++)
+        {
+            block.cells.push_back(i);
+            cell_levels[i] = 0;
+        }
+        block.level_offsets.push_back(block.cells.size());
+        add_halo_levels(block, N_LEVELS);
+
+        for (Index i : block.cells)
+            cell_levels[i] = BlockRegion::NOT_IN_BLOCK;
+        n_cells_with_halo += block.cells.size();
+    }
+
+    /*Every cell is advanced once per stage by its own block, the halo cells are processed again by the blocks
+    around them*/
+    cout << "Temporal blocking: " << cell_blocks.size() << " blocks of at most " << BLOCK_CELLS << " cells ("
+         << config.get_temporal_block_size_kb() << " kB), " << N_LEVELS - 1 << " halo layers, "
+         << std::fixed << std::setprecision(2) << static_cast<Scalar>(n_cells_with_halo) / std::max<Index>(N_INTERIOR_CELLS, 1)
+         << " cells with halo per cell\n"
+         << std::defaultfloat << std::setprecision(6);
 }
 
-void Solver::evaluate_flux_balance(const Config &config, const VecField &cons_vars)
+void Solver::add_halo_levels(CellBlock &block, ShortIndex n_levels)
 {
-    assert(validity_checker->valid_consvars_interior(cons_vars));
+    const auto &faces = grid.get_faces();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = cell_levels.size();
 
-    solver_data->get_flux_balance().set_zero();
+    assert(block.n_levels() == 1);
 
-    solver_data->set_primvars(cons_vars, config);
+    for (ShortIndex level{1}; level < n_levels; level++)
+    {
+        for (Index c{block.level_offsets[level - 1]}; c < block.level_offsets[level]; c++)
+            for (Index k{cell_connectivity.begin(block.cells[c])}; k < cell_connectivity.end(block.cells[c]); k++)
+            {
+                const Index j = cell_connectivity.neighbours[k];
+                if (j < N_INTERIOR_CELLS && cell_levels[j] == BlockRegion::NOT_IN_BLOCK)
+                {
+                    cell_levels[j] = level;
+                    block.cells.push_back(j);
+                }
+            }
+        block.level_offsets.push_back(block.cells.size());
+    }
 
-    assert(validity_checker->valid_primvars_interior(solver_data->get_primvars()));
-    set_constant_ghost_values(config);
-    assert(validity_checker->valid_primvars_ghost(solver_data->get_primvars()));
+    /*Faces of the cells below the last level. The interior faces between two such cells are found twice*/
+    for (Index c{0}; c < block.level_offsets[n_levels - 1]; c++)
+        for (Index k{cell_connectivity.begin(block.cells[c])}; k < cell_connectivity.end(block.cells[c]); k++)
+        {
+            if (cell_connectivity.neighbours[k] < N_INTERIOR_CELLS)
+                block.interior_faces.push_back(cell_connectivity.face_indices[k]);
+            else
+                block.boundary_faces.push_back(cell_connectivity.face_indices[k]);
+        }
+    std::sort(block.interior_faces.begin(), block.interior_faces.end());
+    block.interior_faces.erase(std::unique(block.interior_faces.begin(), block.interior_faces.end()), block.interior_faces.end());
+    std::sort(block.boundary_faces.begin(), block.boundary_faces.end());
+
+    for (Index ij : block.interior_faces)
+        block.interior_face_levels.push_back(std::min(cell_levels[faces[ij].i], cell_levels[faces[ij].j]));
+    for (Index ij : block.boundary_faces)
+        block.boundary_face_levels.push_back(cell_levels[faces[ij].i]);
+}
 
-    validity_checker->write_debug_info(solver_data->get_primvars(), "Primvars");
+void Solver::create_active_region(const Config &config, const Vector<Index> &active_cells)
+{
+    for (Index i : active_region.cells)
+        cell_levels[i] = BlockRegion::NOT_IN_BLOCK;
+
+    active_region = CellBlock{};
+    active_region.cells = active_cells;
+    for (Index i : active_cells)
+        cell_levels[i] = 0;
+    active_region.level_offsets = {0, static_cast<Index>(active_cells.size())};
+    add_halo_levels(active_region, stage_halo_width(config) + 1);
+}
 
-    if (config.get_spatial_order() == SpatialOrder::Second)
+EulerSolver::EulerSolver(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    : Solver(grid, config, thread_pool), store_ghost_cells{config.get_store_ghost_cells()},
+      viscosity{config.get_dynamic_viscosity()},
+      heat_conduction{viscosity > 0.0 ? viscosity * EulerEqs::GAMMA / (EulerEqs::GAMMA_MINUS_ONE * config.get_prandtl_number()) : 0.0},
+      viscous_time_step_factor{viscosity > 0.0 ? 4.0 * std::max(4.0 / 3.0, EulerEqs::GAMMA) / config.get_prandtl_number() : 0.0},
+      math_iterations{config.get_fast_math_iterations()}
+{
+    solver_data = make_unique<EulerSolverData>(config, thread_pool);
+    validity_checker = make_unique<EulerValidityChecker>(config);
+
+    if (config.get_limiter_shock_sensor())
+    {
+        /*Cells that are never flagged by the shock sensor are left unlimited*/
+        solver_data->get_primvars_limiter() = 1.0;
+        limited_cell_marker.assign(config.get_N_INTERIOR_CELLS(), 0);
+    }
+
+    if (config.get_face_tile_size_kb() > 0)
+        create_face_tiles(config);
+
+    if (config.get_temporal_block_size_kb() > 0)
+        create_cell_blocks(config);
+
+    if (config.get_task_partitions() > 0)
+        create_flux_balance_task_graph(config);
+
+    if (config.get_task_partitions() > 0 || (config.get_n_threads() > 1 && config.get_deterministic_accumulation()))
     {
-        evaluate_gradient(config);
+        face_fluxes.resize(config.get_N_TOTAL_FACES());
+        face_spectral_radii.resize(config.get_N_TOTAL_FACES());
+    }
 
+    if (config.get_N_PASSIVE_SCALARS() > 0)
+        passive_scalars = make_unique<PassiveScalarData>(config, thread_pool);
+
+    if (config.get_time_scheme() == TimeScheme::LUSGS)
+        create_sweep_order(config);
+
+    if (config.get_activity_tolerance() > 0.0)
+    {
+        const Scalar density = config.get_primvars_inf(primvars_index::Density);
+        const Scalar sound_speed = sqrt(EulerEqs::GAMMA * config.get_primvars_inf(primvars_index::Pressure) / density);
+        activity_scales = {density, density * sound_speed, density * sound_speed, density * sound_speed,
+                           density * sound_speed * sound_speed};
+        activity_marker.assign(config.get_N_INTERIOR_CELLS(), 0);
+        cell_levels.assign(config.get_N_INTERIOR_CELLS(), BlockRegion::NOT_IN_BLOCK);
+    }
+}
+
+void EulerSolver::create_flux_balance_task_graph(const Config &config)
+{
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+
+    partition_size = (N_INTERIOR_CELLS + config.get_task_partitions() - 1) / config.get_task_partitions();
+    n_task_partitions = (N_INTERIOR_CELLS + partition_size - 1) / partition_size;
+
+    const Index N_PHASES = static_cast<Index>(TaskPhase::N_PHASES);
+    for (Index t{0}; t < N_PHASES * n_task_partitions; t++)
+        flux_balance_tasks.add_task();
+
+    auto task = [&](TaskPhase phase, Index p)
+    { return static_cast<Index>(phase) * n_task_partitions + p; };
+
+    for (Index p{0}; p < n_task_partitions; p++)
+    {
+        std::set<Index> neighbour_partitions{p};
+        for (Index i{p * partition_size}; i < std::min((p + 1) * partition_size, N_INTERIOR_CELLS); i++)
+            for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+                if (cell_connectivity.neighbours[k] < N_INTERIOR_CELLS)
+                    neighbour_partitions.insert(cell_connectivity.neighbours[k] / partition_size);
+
+        for (Index q : neighbour_partitions)
+        {
+            flux_balance_tasks.add_dependency(task(TaskPhase::Primvars, q), task(TaskPhase::Gradient, p));
+            flux_balance_tasks.add_dependency(task(TaskPhase::Limiter, q), task(TaskPhase::Fluxes, p));
+            flux_balance_tasks.add_dependency(task(TaskPhase::Fluxes, q), task(TaskPhase::FluxBalance, p));
+        }
+        flux_balance_tasks.add_dependency(task(TaskPhase::Gradient, p), task(TaskPhase::Limiter, p));
+    }
+    flux_balance_tasks.finalize();
+
+    cout << "Flux balance task graph: " << n_task_partitions << " partitions of at most " << partition_size << " cells, "
+         << flux_balance_tasks.n_tasks() << " tasks, " << flux_balance_tasks.n_dependencies() << " dependencies\n";
+}
+
+void EulerSolver::create_face_tiles(const Config &config)
+{
+    const auto &faces = grid.get_faces();
+    const Index N_INTERIOR_FACES = config.get_N_INTERIOR_FACES();
+
+    /*Cell data used by the flux sweep, gathered per tile*/
+    size_t bytes_per_cell = sizeof(StorageEulerVec) + sizeof(EulerVec) + sizeof(Scalar);
+    if (config.get_spatial_order() == SpatialOrder::Second)
+    {
+        bytes_per_cell += sizeof(StorageEulerGrad);
         if (config.get_limiter() != Limiter::NONE)
-            evaluate_limiter(config);
+            bytes_per_cell += sizeof(StorageEulerVec);
     }
+    const Index MAX_TILE_CELLS = std::max<Index>(1024 * config.get_face_tile_size_kb() / bytes_per_cell, 2);
 
-    evaluate_inviscid_fluxes(config);
+    constexpr Index NOT_IN_TILE = std::numeric_limits<Index>::max();
+    Vector<Index> local_index(config.get_N_INTERIOR_CELLS(), NOT_IN_TILE);
 
-    evaluate_viscous_fluxes(config);
+    face_tile_offsets = {0};
+    tile_cell_offsets = {0};
+    tile_cells.clear();
+    tile_face_cells.resize(N_INTERIOR_FACES);
 
-    validity_checker->check_flux_balance_validity(config, solver_data->get_flux_balance());
+    auto close_tile = [&](Index end_face)
+    {
+        for (Index c{tile_cell_offsets.back()}; c < tile_cells.size(); c++)
+            local_index[tile_cells[c]] = NOT_IN_TILE;
+        face_tile_offsets.push_back(end_face);
+        tile_cell_offsets.push_back(tile_cells.size());
+    };
+
+    auto local_cell = [&](Index i)
+    {
+        if (local_index[i] == NOT_IN_TILE)
+        {
+            local_index[i] = tile_cells.size() - tile_cell_offsets.back();
+            tile_cells.push_back(i);
+        }
+        return local_index[i];
+    };
+
+    for (Index ij{0}; ij < N_INTERIOR_FACES; ij++)
+    {
+        const Index i = faces[ij].i;
+        const Index j = faces[ij].j;
+        const Index n_tile_cells = tile_cells.size() - tile_cell_offsets.back();
+        const Index n_new_cells = (local_index[i] == NOT_IN_TILE) + (local_index[j] == NOT_IN_TILE);
+
+        if (n_tile_cells + n_new_cells > MAX_TILE_CELLS)
+            close_tile(ij);
+
+        tile_face_cells[ij] = {local_cell(i), local_cell(j)};
+    }
+    if (face_tile_offsets.back() < N_INTERIOR_FACES)
+        close_tile(N_INTERIOR_FACES);
+
+    const Index n_tiles = face_tile_offsets.size() - 1;
+    tile_primvars.resize(MAX_TILE_CELLS);
+    tile_gradients.resize(MAX_TILE_CELLS);
+    tile_limiters.resize(MAX_TILE_CELLS);
+    tile_flux_balance.resize(MAX_TILE_CELLS);
+    tile_spectral_radii.resize(MAX_TILE_CELLS);
+
+    /*Each face references two cells, the references to cells already gathered for the tile are hits*/
+    const Scalar hit_rate = 1.0 - static_cast<Scalar>(tile_cells.size()) / (2.0 * std::max<Index>(N_INTERIOR_FACES, 1));
+    cout << "Face tiles: " << n_tiles << " tiles of at most " << MAX_TILE_CELLS << " cells ("
+         << config.get_face_tile_size_kb() << " kB), " << N_INTERIOR_FACES / std::max<Index>(n_tiles, 1)
+         << " faces per tile on average, cell hit rate " << std::fixed << std::setprecision(1) << 100 * hit_rate << " %\n"
+         << std::defaultfloat << std::setprecision(6);
 }
 
-void Solver::explicit_euler(const Config &config)
+void EulerSolver::create_sweep_order(const Config &config)
 {
-    const Scalar dt = config.get_delta_time();
-    VecField &U = solver_data->get_solution();
-    VecField &R = solver_data->get_flux_balance();
-    const auto &cells = grid.get_cells();
-    Index i, j;
+    /*Breadth first from a cell of lowest degree, visiting the neighbours by increasing degree, then reversed. Cells
+    close in the sweep are close in the mesh, so a cell depends on the cells swept shortly before it, and the wave
+    of updates crosses the mesh in one sweep. Every component of the mesh is started from its own cell*/
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    constexpr Index NOT_VISITED = std::numeric_limits<Index>::max();
+
+    auto degree = [&](Index i)
+    {
+        Index n_neighbours{0};
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            n_neighbours += cell_connectivity.neighbours[k] < N_INTERIOR_CELLS;
+        return n_neighbours;
+    };
+
+    Vector<Index> cells_by_degree(N_INTERIOR_CELLS);
+    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+        cells_by_degree[i] = i;
+    std::stable_sort(cells_by_degree.begin(), cells_by_degree.end(), [&](Index a, Index b)
+                     { return degree(a) < degree(b); });
+
+    sweep_order.clear();
+    sweep_order.reserve(N_INTERIOR_CELLS);
+    sweep_position.assign(N_INTERIOR_CELLS, NOT_VISITED);
+    Vector<Index> neighbours;
+
+    for (Index start : cells_by_degree)
+    {
+        if (sweep_position[start] != NOT_VISITED)
+            continue;
+        sweep_position[start] = sweep_order.size();
+        sweep_order.push_back(start);
 
-    assert(U.get_N_EQS() == solver_data->get_N_EQS() && R.get_N_EQS() == solver_data->get_N_EQS());
-    assert(U.size() == config.get_N_INTERIOR_CELLS() && R.size() == config.get_N_INTERIOR_CELLS());
+        for (Index head{sweep_position[start]}; head < sweep_order.size(); head++)
+        {
+            const Index i = sweep_order[head];
+            neighbours.clear();
+            for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            {
+                const Index j = cell_connectivity.neighbours[k];
+                if (j < N_INTERIOR_CELLS && sweep_position[j] == NOT_VISITED)
+                    neighbours.push_back(j);
+            }
+            std::stable_sort(neighbours.begin(), neighbours.end(), [&](Index a, Index b)
+                             { return degree(a) < degree(b); });
+            for (Index j : neighbours)
+            {
+                sweep_position[j] = sweep_order.size();
+                sweep_order.push_back(j);
+            }
+        }
+    }
+    assert(sweep_order.size() == N_INTERIOR_CELLS);
 
-    /*--------------------------------------------------------------------
-     U_n+1 = U_n + dt /Omega * R(U_n)
-    --------------------------------------------------------------------*/
+    std::reverse(sweep_order.begin(), sweep_order.end());
+    for (Index position{0}; position < N_INTERIOR_CELLS; position++)
+        sweep_position[sweep_order[position]] = position;
 
-    evaluate_flux_balance(config, U);
-    for_all(U, i, j)
-        U(i, j) += dt / cells[i].cell_volume * R(i, j);
+    Index bandwidth{0};
+    for (Index ij{0}; ij < config.get_N_INTERIOR_FACES(); ij++)
+    {
+        const Index p_i = sweep_position[grid.get_faces()[ij].i], p_j = sweep_position[grid.get_faces()[ij].j];
+        bandwidth = std::max(bandwidth, p_i > p_j ? p_i - p_j : p_j - p_i);
+    }
+    cout << "LU-SGS sweep order: reverse Cuthill-McKee, bandwidth " << bandwidth << " cells\n";
 }
 
-void Solver::TVD_RK3(const Config &config)
+template <typename FluxBalanceEvaluator>
+void EulerSolver::LU_SGS(const Config &config, FluxBalanceEvaluator &&evaluate_flux_balance)
 {
-    const Scalar dt = config.get_delta_time();
     VecField &U = solver_data->get_solution();
-    VecField &U_old = solver_data->get_solution_old();
     VecField &R = solver_data->get_flux_balance();
-    const auto &cells = grid.get_cells();
-    Index i, j;
-
-    assert(U.get_N_EQS() == solver_data->get_N_EQS() && U_old.get_N_EQS() == solver_data->get_N_EQS() && R.get_N_EQS() == solver_data->get_N_EQS());
-    assert(U.size() == config.get_N_INTERIOR_CELLS() && U_old.size() == config.get_N_INTERIOR_CELLS());
-    assert(R.size() == config.get_N_INTERIOR_CELLS());
+    const Vector<Scalar> &spectral_radii = dynamic_cast<const EulerSolverData &>(*solver_data).get_spectral_radii();
+    const auto &faces = grid.get_faces();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
 
     /*--------------------------------------------------------------------
-    U_1 = U_n + dt /Omega * R(U_n)
-    U_2 = 3/4 * U_n + 1/4 *U_1 + 1/4 * dt / Omega * R(U_1)
-    U_n+1 = 1/3 * U_n + 2/3 * U_2 + 2/3 * dt / Omega * R(U_2)
+    Backward Euler, (Omega / dt + dR/dU) dU = R(U_n), with the Jacobian of
+    the flux through face ij approximated as that of a Rusanov flux of the
+    cell values, 1/2 * (A_i + A_j) - 1/2 * lambda_ij (I_j - I_i), where
+    lambda_ij = max(|v_n| + c) of the two cells. The terms of cell i are
+    summed into the scalar diagonal
+        D_i = Omega_i / dt_i + 1/2 * sum_j lambda_ij * S_ij
+    using the spectral radii of the flux evaluation, while those of the
+    neighbours are evaluated matrix-free from flux differences,
+        dF_ij(dU_j) = F(U_j + dU_j) - F(U_j), normal of ij out of cell i.
+    The system is solved by one symmetric Gauss-Seidel sweep (LU-SGS,
+    Jameson and Yoon, see Blazek):
+        forward:  dU*_i = (R_i - 1/2 * sum_lower (dF_ij(dU*_j) - lambda_ij * S_ij * dU*_j)) / D_i
+        backward: dU_i = dU*_i - 1/2 * sum_upper (dF_ij(dU_j) - lambda_ij * S_ij * dU_j) / D_i
+    The ghost cells do not change within the step (dU = 0). dU is stored
+    in place of the flux balance, so no memory is added beyond the sweep order
     --------------------------------------------------------------------*/
 
-    evaluate_flux_balance(config, U);
-    for_all(U, i, j)
-        U(i, j) += dt / cells[i].cell_volume * R(i, j);
+    evaluate_flux_balance(U, std::true_type{});
+    const auto dt_over_vol = time_step_over_volume(config);
+
+    /*The sweeps overwrite the flux balance, so the residual norms are taken first*/
+    parallel_for_all_with_residual_norms([](Index, Index) {});
+
+    phase_timings["LU-SGS sweeps"].start();
 
-    evaluate_flux_balance(config, U);
-    for_all(U, i, j)
-        U(i, j) = 3.0 / 4.0 * U_old(i, j) + 1.0 / 4.0 * U(i, j) + 1.0 / 4.0 * dt / cells[i].cell_volume * R(i, j);
+    auto diagonal = [&](Index i)
+    { return 1.0 / dt_over_vol(i) + 0.5 * spectral_radii[i]; };
+
+    /*Sum of the off-diagonal terms of the neighbours of cell i on the given side of the sweep*/
+    auto off_diagonal_sum = [&](Index i, auto is_on_side)
+    {
+        const auto U_i = U.get_variable<EulerVec>(i);
+        EulerVec sum = EulerVec::Zero();
+        for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+        {
+            const Index j = cell_connectivity.neighbours[k];
+            if (j >= N_INTERIOR_CELLS || !is_on_side(sweep_position[j]))
+                continue;
+            const Face &face = faces[cell_connectivity.face_indices[k]];
+            const Vec3 S_ij = (face.i == i ? 1.0 : -1.0) * face.S_ij.cast<Scalar>();
+            const Scalar area = S_ij.norm();
+            const Vec3 normal = S_ij / area;
+
+            const auto U_j = U.get_variable<EulerVec>(j);
+            const auto dU_j = R.get_variable<EulerVec>(j);
+            const Scalar lambda_ij = std::max(EulerEqs::conv_spectral_radii<0>(U_i, normal), EulerEqs::conv_spectral_radii<0>(U_j, normal));
+            const EulerVec dF_ij = EulerEqs::inviscid_flux(EulerVec{U_j + dU_j}, normal) - EulerEqs::inviscid_flux(U_j, normal);
+            sum += 0.5 * area * (dF_ij - lambda_ij * dU_j);
+        }
+        return sum;
+    };
+
+    for (Index position{0}; position < N_INTERIOR_CELLS; position++)
+    {
+        const Index i = sweep_order[position];
+        const EulerVec lower_sum = off_diagonal_sum(i, [position](Index position_j)
+                                                    { return position_j < position; });
+        auto dU_i = R.get_variable<EulerVec>(i);
+        dU_i = (dU_i - lower_sum) / diagonal(i);
+    }
 
-    evaluate_flux_balance(config, U);
-    for_all(U, i, j)
-        U(i, j) = 1.0 / 3.0 * U_old(i, j) + 2.0 / 3.0 * U(i, j) + 2.0 / 3.0 * dt / cells[i].cell_volume * R(i, j);
+    for (Index position{N_INTERIOR_CELLS}; position-- > 0;)
+    {
+        const Index i = sweep_order[position];
+        const EulerVec upper_sum = off_diagonal_sum(i, [position](Index position_j)
+                                                    { return position_j > position; });
+        auto dU_i = R.get_variable<EulerVec>(i);
+        dU_i -= upper_sum / diagonal(i);
+    }
+
+    phase_timings["LU-SGS sweeps"].stop();
+
+    parallel_for_all_in_memory_order(U, [&](Index i, Index j)
+                                     { U(i, j) += R(i, j); });
 }
 
-EulerSolver::EulerSolver(const Config &config, const geom::Grid &grid) : Solver(grid, config)
+template <typename Options>
+void EulerSolverPipeline<Options>::step(Config &config)
 {
-    solver_data = make_unique<EulerSolverData>(config);
-    validity_checker = make_unique<EulerValidityChecker>(config);
 
-    calc_Delta_S(config);
+    residual_norms_current = false;
+
+    /*Between the full sweeps of the activity tracking, only the active region is evaluated and updated*/
+    if (config.get_activity_tolerance() > 0.0)
+        active_region_only = config.get_timestep() % config.get_activity_full_sweep_interval() != 0;
+
+    /*The first stage accumulates the spectral radii in the face loop, which gives the time step of this step*/
+    auto evaluate_flux_balance = [this, &config](const VecField &cons_vars, auto first_stage)
+    {
+        constexpr bool FIRST_STAGE = decltype(first_stage)::value;
+        if (active_region_only)
+            evaluate_region_flux_balance<FIRST_STAGE>(config, cons_vars, BlockRegion{active_region, cell_levels, 0});
+        else
+            this->evaluate_flux_balance<FIRST_STAGE>(config, cons_vars);
+        if constexpr (FIRST_STAGE)
+            calc_timestep(config);
+    };
+
+    if constexpr (Options::time_scheme == TimeScheme::ExplicitEuler)
+        explicit_euler(config, evaluate_flux_balance);
+    else if constexpr (Options::time_scheme == TimeScheme::LUSGS)
+        LU_SGS(config, evaluate_flux_balance);
+    else
+    {
+        static_assert(Options::time_scheme == TimeScheme::TVD_RK3);
+        if (cell_blocks.empty())
+            TVD_RK3(config, evaluate_flux_balance);
+        else
+            TVD_RK3_temporal_blocking(config, evaluate_flux_balance, [this, &config](const VecField &cons_vars, const BlockRegion &region)
+                                      { evaluate_region_flux_balance<false>(config, cons_vars, region); });
+    }
+
+    if constexpr (Options::limiter != Limiter::NONE)
+    {
+        report_limited_cells(config);
+        update_limiter_freezing(config);
+    }
+
+    if (config.get_activity_tolerance() > 0.0)
+        update_activity(config);
+
+    solver_data->get_solution_old() = solver_data->get_solution();
+    if (passive_scalars)
+        passive_scalars->get_solution_old() = passive_scalars->get_solution();
 }
 
-void EulerSolver::evaluate_inviscid_fluxes(const Config &config)
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_flux_balance(const Config &config, const VecField &cons_vars)
 {
+    assert(validity_checker->valid_consvars_interior(cons_vars));
+
+    if (n_task_partitions > 0)
+    {
+        evaluate_flux_balance_tasks<CALC_SPECTRAL_RADII>(config, cons_vars);
+        return;
+    }
+
+    solver_data->get_flux_balance().set_zero();
+    if (passive_scalars)
+        passive_scalars->get_flux_balance().set_zero();
+
+    phase_timings["primitive variables"].start();
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    thread_pool.parallel_for_chunks(0, config.get_N_INTERIOR_CELLS(), [&](Index first, Index last)
+                                    { euler_data.set_primvars(cons_vars, first, last); });
+
+    assert(validity_checker->valid_primvars_interior(solver_data->get_primvars()));
+    if (store_ghost_cells)
+    {
+        set_constant_ghost_values(config);
+        assert(validity_checker->valid_primvars_ghost(solver_data->get_primvars()));
+    }
+    phase_timings["primitive variables"].stop();
+
+    validity_checker->write_debug_info(solver_data->get_primvars(), "Primvars");
+
+    if constexpr (Options::spatial_order == SpatialOrder::Third)
+    {
+        phase_timings["k-exact fit"].start();
+        evaluate_kexact_fit(config);
+        phase_timings["k-exact fit"].stop();
+    }
+    else if constexpr (Options::spatial_order == SpatialOrder::Second)
+    {
+        phase_timings["gradient"].start();
+        evaluate_gradient(config, WholeMesh{config, &thread_pool});
+        phase_timings["gradient"].stop();
+
+        /*A frozen limiter keeps the values from its last evaluation*/
+        if constexpr (Options::limiter != Limiter::NONE)
+        {
+            if (!limiter_frozen)
+            {
+                phase_timings["limiter"].start();
+                evaluate_limiter<Options::limiter>(config, WholeMesh{config, &thread_pool});
+                phase_timings["limiter"].stop();
+            }
+        }
+    }
+
+    /*Includes the viscous fluxes of the Navier-Stokes pipelines, which share the face loops*/
+    phase_timings["inviscid fluxes"].start();
+    evaluate_inviscid_fluxes<CALC_SPECTRAL_RADII>(config);
+    phase_timings["inviscid fluxes"].stop();
+
+    validity_checker->check_flux_balance_validity(config, solver_data->get_flux_balance());
+}
+
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_flux_balance_tasks(const Config &config, const VecField &cons_vars)
+{
+    constexpr bool SECOND_ORDER = Options::spatial_order == SpatialOrder::Second;
+    constexpr bool LIMITED = SECOND_ORDER && Options::limiter != Limiter::NONE;
+
+    const auto &faces = grid.get_faces();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const Scalar K = config.get_venkatakrishnan_K();
+    const GradientScheme grad_scheme = config.get_grad_scheme();
+
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    const StorageVecField &primvars = solver_data->get_primvars();
+    GradField &primvars_grad = solver_data->get_primvars_gradient();
+    StorageVecField &primvars_limiter = solver_data->get_primvars_limiter();
+    VecField &flux_balance = solver_data->get_flux_balance();
+
+    auto boundary_value = [this](Index ij, const EulerVec &V_i)
+    { return calc_boundary_primvars(ij, V_i); };
+
+    /*Each task only writes to its own cells, to the ghost cells and faces owned by them, so the tasks need no
+    synchronization beyond their dependencies*/
+    auto run_task = [&](Index task)
+    {
+        const Index p = task % n_task_partitions;
+        const Index first_cell = p * partition_size;
+        const Index end_cell = std::min(first_cell + partition_size, N_INTERIOR_CELLS);
+
+        switch (static_cast<TaskPhase>(task / n_task_partitions))
+        {
+        case TaskPhase::Primvars:
+            euler_data.set_primvars(cons_vars, first_cell, end_cell);
+            if (store_ghost_cells)
+                for (Index i{first_cell}; i < end_cell; i++)
+                    for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+                        if (cell_connectivity.neighbours[k] >= N_INTERIOR_CELLS)
+                            set_ghost_value(cell_connectivity.face_indices[k]);
+            break;
+        case TaskPhase::Gradient:
+            /*The scheme is resolved once per task, so that each cell loop calls a single kernel*/
+            if constexpr (SECOND_ORDER)
+            {
+                switch (grad_scheme)
+                {
+                case GradientScheme::GreenGauss:
+                    for (Index i{first_cell}; i < end_cell; i++)
+                        Gradient::calc_green_gauss_cell_gradient<N_EQS_EULER>(i, grid, primvars, primvars_grad, N_INTERIOR_CELLS, boundary_value);
+                    break;
+                case GradientScheme::LeastSquares:
+                    for (Index i{first_cell}; i < end_cell; i++)
+                        Gradient::calc_least_squares_cell_gradient<N_EQS_EULER>(i, grid, primvars, primvars_grad, N_INTERIOR_CELLS, boundary_value);
+                    break;
+                default:
+                    assert(false);
+                }
+            }
+            break;
+        case TaskPhase::Limiter:
+            if constexpr (LIMITED)
+                if (!limiter_frozen)
+                    for (Index i{first_cell}; i < end_cell; i++)
+                        Reconstruction::calc_cell_limiter<Options::limiter, N_EQS_EULER>(i, grid, primvars, primvars_grad, primvars_limiter,
+                                                                                         K * K * K, boundary_value);
+            break;
+        case TaskPhase::Fluxes:
+            for (Index i{first_cell}; i < end_cell; i++)
+                for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+                {
+                    const Index ij = cell_connectivity.face_indices[k];
+                    if (faces[ij].i == i)
+                        face_spectral_radii[ij] = calc_face_flux(ij, cell_connectivity.neighbours[k] >= N_INTERIOR_CELLS, face_fluxes[ij]);
+                }
+            break;
+        case TaskPhase::FluxBalance:
+            for (Index i{first_cell}; i < end_cell; i++)
+                gather_face_fluxes<CALC_SPECTRAL_RADII>(i);
+            break;
+        default:
+            assert(false);
+        }
+    };
+
+    phase_timings["flux balance tasks"].start();
+    flux_balance_tasks.execute(thread_pool, run_task);
+    phase_timings["flux balance tasks"].stop();
+
+    assert(validity_checker->valid_primvars_interior(solver_data->get_primvars()));
+    validity_checker->check_flux_balance_validity(config, flux_balance);
+}
+
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::gather_face_fluxes(Index i)
+{
+    const auto &faces = grid.get_faces();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+
+    EulerVec flux_balance_i = EulerVec::Zero();
+    Scalar spectral_radius_i{0.0};
+    for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+    {
+        const Index ij = cell_connectivity.face_indices[k];
+        if (faces[ij].i == i)
+            flux_balance_i -= face_fluxes[ij];
+        else
+            flux_balance_i += face_fluxes[ij];
+        if constexpr (CALC_SPECTRAL_RADII)
+            spectral_radius_i += face_spectral_radii[ij];
+    }
+    solver_data->get_flux_balance().get_variable<EulerVec>(i) = flux_balance_i;
+    if constexpr (CALC_SPECTRAL_RADII)
+        dynamic_cast<EulerSolverData &>(*solver_data).get_spectral_radii()[i] = spectral_radius_i;
+
+    if (passive_scalars)
+        gather_scalar_face_fluxes(i);
+}
+
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_parallel_inviscid_fluxes(const Config &config)
+{
+    const Index N_INTERIOR_FACES = config.get_N_INTERIOR_FACES();
+    const Index N_TOTAL_FACES = config.get_N_TOTAL_FACES();
+
+    if (config.get_deterministic_accumulation())
+    {
+        thread_pool.parallel_for(0, N_TOTAL_FACES, [&](Index ij)
+                                 {
+            face_spectral_radii[ij] = calc_face_flux(ij, ij >= N_INTERIOR_FACES, face_fluxes[ij]);
+            assert(ij < N_INTERIOR_FACES ||
+                   validity_checker->valid_boundary_flux(face_fluxes[ij].data(), grid.get_patches()[find_patch_index(ij)].boundary_type)); });
+
+        thread_pool.parallel_for(0, config.get_N_INTERIOR_CELLS(), [&](Index i)
+                                 { gather_face_fluxes<CALC_SPECTRAL_RADII>(i); });
+        return;
+    }
+
     VecField &flux_balance = solver_data->get_flux_balance();
+    Vector<Scalar> &spectral_radii = dynamic_cast<EulerSolverData &>(*solver_data).get_spectral_radii();
+    const auto &faces = grid.get_faces();
+
+    if constexpr (CALC_SPECTRAL_RADII)
+        std::fill(spectral_radii.begin(), spectral_radii.end(), 0.0);
+
+    /*flux_balance has been zeroed by evaluate_flux_balance*/
+    thread_pool.parallel_for(0, N_TOTAL_FACES, [&](Index ij)
+                             {
+        const Index i = faces[ij].i;
+        const Index j = faces[ij].j;
+        const bool boundary_face = ij >= N_INTERIOR_FACES;
+
+        EulerVec flux;
+        const Scalar spectral_radius = calc_face_flux(ij, boundary_face, flux);
+        assert(!boundary_face || validity_checker->valid_boundary_flux(flux.data(), grid.get_patches()[find_patch_index(ij)].boundary_type));
+
+        for (ShortIndex k{0}; k < N_EQS_EULER; k++)
+        {
+            Scalar &flux_balance_i = flux_balance(i, k);
+#pragma omp atomic
+            flux_balance_i -= flux[k];
+            if (!boundary_face)
+            {
+                Scalar &flux_balance_j = flux_balance(j, k);
+#pragma omp atomic
+                flux_balance_j += flux[k];
+            }
+        }
+
+        if constexpr (CALC_SPECTRAL_RADII)
+        {
+#pragma omp atomic
+            spectral_radii[i] += spectral_radius;
+            if (!boundary_face)
+            {
+#pragma omp atomic
+                spectral_radii[j] += spectral_radius;
+            }
+        }
+
+        if (passive_scalars)
+        {
+            VecField &scalar_flux_balance = passive_scalars->get_flux_balance();
+            for_scalar_face_fluxes(ij, boundary_face, flux[0], [&](ShortIndex k, Scalar scalar_flux)
+                                   {
+                Scalar &scalar_flux_balance_i = scalar_flux_balance(i, k);
+#pragma omp atomic
+                scalar_flux_balance_i -= scalar_flux;
+                if (!boundary_face)
+                {
+                    Scalar &scalar_flux_balance_j = scalar_flux_balance(j, k);
+#pragma omp atomic
+                    scalar_flux_balance_j += scalar_flux;
+                } });
+        } });
+}
+
+template <typename Options>
+Scalar EulerSolverPipeline<Options>::calc_face_flux(Index ij, bool boundary_face, EulerVec &flux)
+{
+    const auto &face = grid.get_faces()[ij];
+    const Vec3 S_ij = face.S_ij.cast<Scalar>();
+
+    EulerVec U_L, U_R, V_L, V_R;
+    EulerVecMap U_L_map{U_L.data()}, U_R_map{U_R.data()}, V_L_map{V_L.data()}, V_R_map{V_R.data()}, flux_map{flux.data()};
+
+    calc_reconstructed_value(face.i, V_L_map, face.r_im.cast<Scalar>());
+    if (boundary_face)
+        BC_container[find_patch_index(ij)]->calc_ghost_val(V_L_map, V_R_map, S_ij);
+    else
+        calc_reconstructed_value(face.j, V_R_map, face.r_jm.cast<Scalar>());
 
-    // const VecField& primvars = solver_data->get_primvars();
-    // const GradField& primvars_grad = solver_data->get_primvars_gradient();
-    // const VecField& primvars_limiter = solver_data->get_primvars_limiter();
+    EulerEqs::prim_to_cons(V_L_map, U_L_map);
+    EulerEqs::prim_to_cons(V_R_map, U_R_map);
+
+    Scalar spec_rad = NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L_map, U_R_map, S_ij, flux_map, math_iterations);
+    if constexpr (Options::viscous)
+        spec_rad += subtract_viscous_flux(ij, boundary_face, flux);
+    return spec_rad * S_ij.norm();
+}
+
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_region_flux_balance(const Config &config, const VecField &cons_vars, const BlockRegion &region)
+{
+    /*The fluxes of the region cells read the reconstructed values of their neighbours, one level further out,
+    and the gradients and limiters of these read the primitive variables of their own neighbours*/
+    const ShortIndex HALO = stage_halo_width(config);
+    const BlockRegion primvars_region{region.block, region.cell_levels, static_cast<ShortIndex>(region.max_level + HALO)};
+    const BlockRegion reconstruction_region{region.block, region.cell_levels, static_cast<ShortIndex>(region.max_level + HALO - 1)};
+
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+
+    const string phase = cell_blocks.empty() ? "active region" : "blocked stages";
+    phase_timings[phase].start();
+    primvars_region.for_cells([&](Index i)
+                              { euler_data.set_primvars(cons_vars, i); });
+    if (store_ghost_cells)
+        set_constant_ghost_values(reconstruction_region);
+
+    if constexpr (Options::spatial_order == SpatialOrder::Second)
+    {
+        evaluate_gradient(config, reconstruction_region);
+
+        if constexpr (Options::limiter != Limiter::NONE)
+            if (!limiter_frozen)
+                evaluate_limiter<Options::limiter>(config, reconstruction_region);
+    }
+
+    evaluate_region_inviscid_fluxes<CALC_SPECTRAL_RADII>(region);
+    phase_timings[phase].stop();
+}
+
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_inviscid_fluxes(const Config &config)
+{
+    VecField &flux_balance = solver_data->get_flux_balance();
 
     Index N_INTERIOR_FACES = config.get_N_INTERIOR_FACES();
-    SpatialOrder spatial_order = config.get_spatial_order();
 
     Index i, j;
     const auto &faces = grid.get_faces();
     const auto &patches = grid.get_patches();
 
-    // InvFluxFunction inv_flux_func = NumericalFlux::get_inviscid_flux_function(config);
-
     EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
     EulerVecMap U_L = euler_data.get_U_L_map();
     EulerVecMap U_R = euler_data.get_U_R_map();
@@ -164,140 +984,324 @@ void EulerSolver::evaluate_inviscid_fluxes(const Config &config)
     EulerVecMap V_R = euler_data.get_V_R_map();
     EulerVecMap Flux_inv = euler_data.get_Flux_inv_map();
 
-    NumericalFlux::InvFluxFunction numerical_flux_func = NumericalFlux::get_inviscid_flux_function(config.get_inv_flux_scheme());
+    if (thread_pool.get_n_threads() > 1)
+    {
+        evaluate_parallel_inviscid_fluxes<CALC_SPECTRAL_RADII>(config);
+        return;
+    }
+
+    Vector<Scalar> &spectral_radii = euler_data.get_spectral_radii();
+    Scalar spec_rad;
+    if constexpr (CALC_SPECTRAL_RADII)
+        std::fill(spectral_radii.begin(), spectral_radii.end(), 0.0);
 
     /*First interior cells*/
-    for (Index ij{0}; ij < N_INTERIOR_FACES; ij++)
+    if (!face_tile_offsets.empty())
+        evaluate_tiled_interior_fluxes<CALC_SPECTRAL_RADII>();
+    else
     {
-        i = faces[ij].i;
-        j = faces[ij].j;
-        const Vec3 &S_ij = faces[ij].S_ij;
-        const Vec3 &r_im = faces[ij].r_im;
-        const Vec3 &r_jm = faces[ij].r_jm;
+        for (Index ij{0}; ij < N_INTERIOR_FACES; ij++)
+        {
+            i = faces[ij].i;
+            j = faces[ij].j;
+            const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
+            const Vec3 r_im = faces[ij].r_im.cast<Scalar>();
+            const Vec3 r_jm = faces[ij].r_jm.cast<Scalar>();
 
-        calc_reconstructed_value(i, V_L, r_im, spatial_order);
-        calc_reconstructed_value(j, V_R, r_jm, spatial_order);
+            calc_reconstructed_value(i, V_L, r_im);
+            calc_reconstructed_value(j, V_R, r_jm);
 
-        EulerEqs::prim_to_cons(V_L, U_L);
-        EulerEqs::prim_to_cons(V_R, U_R);
+            EulerEqs::prim_to_cons(V_L, U_L);
+            EulerEqs::prim_to_cons(V_R, U_R);
+
+            spec_rad = NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L, U_R, S_ij, Flux_inv, math_iterations);
+            if constexpr (Options::viscous)
+                spec_rad += subtract_viscous_flux(ij, false, Flux_inv);
 
-        numerical_flux_func(U_L, U_R, S_ij, Flux_inv);
-        // cout << "F_inf " << endl
-        //      << Flux_inv << endl
-        //      << endl;
+            flux_balance.get_variable<EulerVec>(i) -= Flux_inv;
+            flux_balance.get_variable<EulerVec>(j) += Flux_inv;
 
-        flux_balance.get_variable<EulerVec>(i) -= Flux_inv;
-        flux_balance.get_variable<EulerVec>(j) += Flux_inv;
+            if constexpr (CALC_SPECTRAL_RADII)
+            {
+                spectral_radii[i] += spec_rad * S_ij.norm();
+                spectral_radii[j] += spec_rad * S_ij.norm();
+            }
+
+            if (passive_scalars)
+                add_scalar_face_fluxes(ij, false, Flux_inv[0]);
+        }
     }
 
     /*Then boundaries. Here ghost cells has to be assigned based on the boundary conditions.
     This is handled patch-wise*/
-    Index i_domain, j_ghost;
+    Index i_domain;
 
     for (Index i_patch{0}; i_patch < patches.size(); i_patch++)
     {
         const auto &patch = patches[i_patch];
         auto &boundary_condition = BC_container[i_patch];
-        // BoundaryCondition::BC_function BC_func = BoundaryCondition::get_BC_function(patch.boundary_type);
 
         for (Index ij{patch.FIRST_FACE}; ij < patch.FIRST_FACE + patch.N_FACES; ij++)
         {
 
             i_domain = faces[ij].i;
-            j_ghost = faces[ij].j;
-            const Vec3 &S_ij = faces[ij].S_ij;
-            const Vec3 &r_im = faces[ij].r_im;
+            const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
+            const Vec3 r_im = faces[ij].r_im.cast<Scalar>();
 
-            calc_reconstructed_value(i_domain, V_L, r_im, spatial_order);
+            calc_reconstructed_value(i_domain, V_L, r_im);
 
             boundary_condition->calc_ghost_val(V_L, V_R, S_ij);
 
             EulerEqs::prim_to_cons(V_L, U_L);
             EulerEqs::prim_to_cons(V_R, U_R);
 
-            numerical_flux_func(U_L, U_R, S_ij, Flux_inv);
+            spec_rad = NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L, U_R, S_ij, Flux_inv, math_iterations);
+            if constexpr (Options::viscous)
+                spec_rad += subtract_viscous_flux(ij, true, Flux_inv);
 
             assert(validity_checker->valid_boundary_flux(Flux_inv.data(), patch.boundary_type));
 
             flux_balance.get_variable<EulerVec>(i_domain) -= Flux_inv;
+
+            if constexpr (CALC_SPECTRAL_RADII)
+                spectral_radii[i_domain] += spec_rad * S_ij.norm();
+
+            if (passive_scalars)
+                add_scalar_face_fluxes(ij, true, Flux_inv[0]);
         }
     }
 }
 
-void EulerSolver::calc_timestep(Config &config)
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_region_inviscid_fluxes(const BlockRegion &region)
 {
-    // --------------------------------------------------------------------
-    // Implementing Method 2 in "Time Step on Unstructured Grids" in Blazek
-    // --------------------------------------------------------------------
+    VecField &flux_balance = solver_data->get_flux_balance();
+    const auto &faces = grid.get_faces();
 
-    /*Delta S only needs updating when the grid is moved*/
-    if (config.get_grid_motion())
-        calc_Delta_S(config);
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    EulerVecMap U_L = euler_data.get_U_L_map();
+    EulerVecMap U_R = euler_data.get_U_R_map();
+    EulerVecMap V_L = euler_data.get_V_L_map();
+    EulerVecMap V_R = euler_data.get_V_R_map();
+    EulerVecMap Flux_inv = euler_data.get_Flux_inv_map();
+    Vector<Scalar> &spectral_radii = euler_data.get_spectral_radii();
+
+    region.for_cells([&](Index i)
+                     {
+        flux_balance.get_variable<EulerVec>(i).setZero();
+        if constexpr (CALC_SPECTRAL_RADII)
+            spectral_radii[i] = 0.0;
+        if (passive_scalars)
+            for (ShortIndex k{0}; k < passive_scalars->get_N_SCALARS(); k++)
+                passive_scalars->get_flux_balance()(i, k) = 0.0; });
+
+    /*The faces are visited in the same order as in evaluate_inviscid_fluxes, so that the sums are the same*/
+    region.for_interior_faces([&](Index ij)
+                              {
+        const Index i = faces[ij].i;
+        const Index j = faces[ij].j;
+        const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
+        const Vec3 r_im = faces[ij].r_im.cast<Scalar>();
+        const Vec3 r_jm = faces[ij].r_jm.cast<Scalar>();
+
+        calc_reconstructed_value(i, V_L, r_im);
+        calc_reconstructed_value(j, V_R, r_jm);
 
-    const EulerSolverData &euler_data = dynamic_cast<const EulerSolverData &>(*solver_data);
-    const Vector<Vec3> &Delta_S = euler_data.get_Delta_S();
+        EulerEqs::prim_to_cons(V_L, U_L);
+        EulerEqs::prim_to_cons(V_R, U_R);
 
-    const Scalar CFL = config.get_CFL();
-    auto cells = grid.get_cells();
+        [[maybe_unused]] Scalar spec_rad =
+            NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L, U_R, S_ij, Flux_inv, math_iterations);
+        if constexpr (Options::viscous)
+            spec_rad += subtract_viscous_flux(ij, false, Flux_inv);
 
-    const auto &primvars = solver_data->get_primvars();
+        if (region.contains(i))
+        {
+            flux_balance.get_variable<EulerVec>(i) -= Flux_inv;
+            if constexpr (CALC_SPECTRAL_RADII)
+                spectral_radii[i] += spec_rad * S_ij.norm();
+        }
+        if (region.contains(j))
+        {
+            flux_balance.get_variable<EulerVec>(j) += Flux_inv;
+            if constexpr (CALC_SPECTRAL_RADII)
+                spectral_radii[j] += spec_rad * S_ij.norm();
+        }
 
-    Scalar c, volume, spec_rad_x, spec_rad_y, spec_rad_z;
+        if (passive_scalars)
+            add_scalar_face_fluxes(ij, false, Flux_inv[0], region.contains(i), region.contains(j)); });
 
-    Scalar delta_time = std::numeric_limits<Scalar>::max(); // Large number
+    region.for_boundary_faces([&](Index ij)
+                              {
+        const Index i_domain = faces[ij].i;
+        const Index i_patch = find_patch_index(ij);
+        const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
+        const Vec3 r_im = faces[ij].r_im.cast<Scalar>();
 
-    for (Index i{0}; i < config.get_N_INTERIOR_CELLS(); i++)
-    {
-        const EulerVecMap V = primvars.get_variable<EulerVec>(i);
-        c = EulerEqs::sound_speed_primitive(V);
+        calc_reconstructed_value(i_domain, V_L, r_im);
+
+        BC_container[i_patch]->calc_ghost_val(V_L, V_R, S_ij);
 
-        volume = cells[i].cell_volume;
+        EulerEqs::prim_to_cons(V_L, U_L);
+        EulerEqs::prim_to_cons(V_R, U_R);
 
-        spec_rad_x = (abs(V[1]) + c) * Delta_S[i].x();
-        spec_rad_y = (abs(V[2]) + c) * Delta_S[i].y();
-        spec_rad_z = (abs(V[3]) + c) * Delta_S[i].z();
+        [[maybe_unused]] Scalar spec_rad =
+            NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L, U_R, S_ij, Flux_inv, math_iterations);
+        if constexpr (Options::viscous)
+            spec_rad += subtract_viscous_flux(ij, true, Flux_inv);
 
-        delta_time = std::min(delta_time, CFL * volume / (spec_rad_x + spec_rad_y + spec_rad_z));
-    }
-    if (!num_is_valid_and_pos(delta_time))
-        throw std::runtime_error("Invalid dt calculated (dt = " + std::to_string(delta_time) + ")");
+        assert(validity_checker->valid_boundary_flux(Flux_inv.data(), grid.get_patches()[i_patch].boundary_type));
 
-    if (delta_time > 0.01)
-        cout << "Warning: Delta time is high (dt = " << delta_time << ")\n";
+        flux_balance.get_variable<EulerVec>(i_domain) -= Flux_inv;
+        if constexpr (CALC_SPECTRAL_RADII)
+            spectral_radii[i_domain] += spec_rad * S_ij.norm();
 
-    config.set_delta_time(delta_time);
+        if (passive_scalars)
+            add_scalar_face_fluxes(ij, true, Flux_inv[0]); });
 }
 
-void EulerSolver::calc_Delta_S(const Config &config)
+template <typename Options>
+template <bool CALC_SPECTRAL_RADII>
+void EulerSolverPipeline<Options>::evaluate_tiled_interior_fluxes()
 {
+    constexpr bool SECOND_ORDER = Options::spatial_order == SpatialOrder::Second;
+    constexpr bool LIMITED = SECOND_ORDER && Options::limiter != Limiter::NONE;
 
     const auto &faces = grid.get_faces();
-    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    const StorageVecField &primvars = solver_data->get_primvars();
+    const GradField &primvars_grad = solver_data->get_primvars_gradient();
+    const StorageVecField &primvars_limiter = solver_data->get_primvars_limiter();
+    VecField &flux_balance = solver_data->get_flux_balance();
 
-    Vector<Vec3> &Delta_S = euler_data.get_Delta_S();
-    std::fill(Delta_S.begin(), Delta_S.end(), Vec3::Zero());
-    Index i, j;
-    Vec3 tmp;
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    EulerVecMap U_L = euler_data.get_U_L_map();
+    EulerVecMap U_R = euler_data.get_U_R_map();
+    EulerVecMap V_L = euler_data.get_V_L_map();
+    EulerVecMap V_R = euler_data.get_V_R_map();
+    EulerVecMap Flux_inv = euler_data.get_Flux_inv_map();
+    Vector<Scalar> &spectral_radii = euler_data.get_spectral_radii();
 
-    for (Index ij{0}; ij < config.get_N_INTERIOR_FACES(); ij++)
+    auto reconstruct = [&](Index c, EulerVecMap &V_f, const Vec3 &r_cf)
     {
-        i = faces[ij].i;
-        j = faces[ij].j;
+        if constexpr (LIMITED)
+            Reconstruction::calc_limited_reconstruction(tile_primvars[c], tile_gradients[c], tile_limiters[c], r_cf, V_f);
+        else if constexpr (SECOND_ORDER)
+            Reconstruction::calc_unlimited_reconstruction(tile_primvars[c], tile_gradients[c], r_cf, V_f);
+        else
+            V_f = tile_primvars[c].template cast<Scalar>();
+    };
+
+    for (Index t{0}; t + 1 < face_tile_offsets.size(); t++)
+    {
+        const Index first_cell = tile_cell_offsets[t];
+        const Index n_cells = tile_cell_offsets[t + 1] - first_cell;
+
+        /*The flux balance and spectral radii are gathered as well, so that the accumulation is the same as
+        without tiling*/
+        for (Index c{0}; c < n_cells; c++)
+        {
+            const Index i = tile_cells[first_cell + c];
+            tile_primvars[c] = primvars.get_variable<StorageEulerVec>(i);
+            if constexpr (SECOND_ORDER)
+                tile_gradients[c] = primvars_grad.get_variable<StorageEulerGrad>(i);
+            if constexpr (LIMITED)
+                tile_limiters[c] = primvars_limiter.get_variable<StorageEulerVec>(i);
+            tile_flux_balance[c] = flux_balance.get_variable<EulerVec>(i);
+            if constexpr (CALC_SPECTRAL_RADII)
+                tile_spectral_radii[c] = spectral_radii[i];
+        }
+
+        for (Index ij{face_tile_offsets[t]}; ij < face_tile_offsets[t + 1]; ij++)
+        {
+            const auto [i, j] = tile_face_cells[ij];
+            const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
+            const Vec3 r_im = faces[ij].r_im.cast<Scalar>();
+            const Vec3 r_jm = faces[ij].r_jm.cast<Scalar>();
 
-        tmp = 0.5 * faces[ij].S_ij.cwiseAbs();
+            reconstruct(i, V_L, r_im);
+            reconstruct(j, V_R, r_jm);
+
+            EulerEqs::prim_to_cons(V_L, U_L);
+            EulerEqs::prim_to_cons(V_R, U_R);
+
+            const Scalar spec_rad = NumericalFlux::calc_inviscid_flux<Options::inv_flux_scheme>(U_L, U_R, S_ij, Flux_inv, math_iterations);
+
+            tile_flux_balance[i] -= Flux_inv;
+            tile_flux_balance[j] += Flux_inv;
+
+            if constexpr (CALC_SPECTRAL_RADII)
+            {
+                tile_spectral_radii[i] += spec_rad * S_ij.norm();
+                tile_spectral_radii[j] += spec_rad * S_ij.norm();
+            }
+        }
 
-        Delta_S[i] += tmp;
-        Delta_S[j] += tmp;
+        for (Index c{0}; c < n_cells; c++)
+        {
+            const Index i = tile_cells[first_cell + c];
+            flux_balance.get_variable<EulerVec>(i) = tile_flux_balance[c];
+            if constexpr (CALC_SPECTRAL_RADII)
+                spectral_radii[i] = tile_spectral_radii[c];
+        }
     }
 }
 
+void EulerSolver::calc_timestep(Config &config)
+{
+    // --------------------------------------------------------------------
+    // dt = min_i CFL * Omega_i / Lambda_i, where the spectral radius of cell i
+    // Lambda_i = 1/2 * sum_faces (|v_n| + c) * Delta S has been accumulated in
+    // the first flux evaluation of the step. On a hexahedron this is equal to
+    // Method 2 in "Time Step on Unstructured Grids" in Blazek. With local time
+    // stepping each cell keeps its own dt_i = CFL * Omega_i / Lambda_i, and
+    // the minimum is only used for the time of the solution
+    // --------------------------------------------------------------------
+
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    const Vector<Scalar> &spectral_radii = euler_data.get_spectral_radii();
+    Vector<Scalar> &local_delta_time = euler_data.get_local_delta_time();
+
+    const Scalar CFL = config.get_CFL();
+    const auto &cells = grid.get_cells();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const bool local_time_stepping = config.get_local_time_stepping();
+
+    assert(local_delta_time.size() == (local_time_stepping ? N_INTERIOR_CELLS : 0));
+
+    const Scalar delta_time = thread_pool.parallel_reduce(
+        0, N_INTERIOR_CELLS, std::numeric_limits<Scalar>::max(),
+        [&](Index i)
+        {
+            const Scalar dt_i = 2 * CFL * cells[i].cell_volume / spectral_radii[i];
+            if (local_time_stepping)
+                local_delta_time[i] = dt_i;
+            return dt_i;
+        },
+        [](Scalar a, Scalar b)
+        { return std::min(a, b); });
+
+    if (!num_is_valid_and_pos(delta_time))
+        throw std::runtime_error("Invalid dt calculated (dt = " + std::to_string(delta_time) + ")");
+
+    if (delta_time > 0.01 && !local_time_stepping && config.get_time_integration_type() == TimeIntegrationType::Explicit)
+        cout << "Warning: Delta time is high (dt = " << delta_time << ")\n";
+
+    config.set_delta_time(delta_time);
+}
+
 void EulerSolver::set_constant_ghost_values(const Config &config)
 {
     const auto &patches = grid.get_patches();
     const auto &faces = grid.get_faces();
-    VecField &primvars = solver_data->get_primvars();
+    StorageVecField &primvars = solver_data->get_primvars();
     Index i_domain, j_ghost;
 
+    /*The boundary conditions work on Scalar values, so the stored primitive variables are copied in and out*/
+    EulerSolverData &euler_data = dynamic_cast<EulerSolverData &>(*solver_data);
+    EulerVecMap V_i_domain = euler_data.get_V_L_map();
+    EulerVecMap V_j_ghost = euler_data.get_V_R_map();
+
     // for (const auto &patch : patches)
     for (Index i_patch{0}; i_patch < patches.size(); i_patch++)
     {
@@ -310,60 +1314,430 @@ void EulerSolver::set_constant_ghost_values(const Config &config)
             j_ghost = faces[ij].j;
             assert(i_domain < config.get_N_INTERIOR_CELLS() && j_ghost >= config.get_N_INTERIOR_CELLS());
 
-            const Vec3 &S_ij = faces[ij].S_ij;
+            const Vec3 S_ij = faces[ij].S_ij.cast<Scalar>();
             // primvars.map_to_variable<EulerVec>(j) =
             //     BoundaryCondition::calc_ghost_val<BC_type, EulerVec>(primvars.map_to_variable<EulerVec>(i), S_ij);
 
-            // Test if this works
-            EulerVecMap V_i_domain = primvars.get_variable<EulerVec>(i_domain);
-            EulerVecMap V_j_ghost = primvars.get_variable<EulerVec>(j_ghost);
+            V_i_domain = primvars.get_variable<StorageEulerVec>(i_domain).cast<Scalar>();
 
             boundary_condition->calc_ghost_val(V_i_domain, V_j_ghost, S_ij);
+
+            primvars.get_variable<StorageEulerVec>(j_ghost) = V_j_ghost.cast<StorageScalar>();
         }
     }
 }
 
-void EulerSolver::evaluate_gradient(const Config &config)
+void EulerSolver::set_constant_ghost_values(const BlockRegion &region)
 {
-    const VecField &primvars = solver_data->get_primvars();
+    region.for_boundary_faces([&](Index ij)
+                              { set_ghost_value(ij); });
+}
+
+void EulerSolver::set_ghost_value(Index ij)
+{
+    const auto &face = grid.get_faces()[ij];
+    StorageVecField &primvars = solver_data->get_primvars();
+
+    EulerVec V_domain = primvars.get_variable<StorageEulerVec>(face.i).cast<Scalar>();
+    EulerVec V_ghost;
+    EulerVecMap V_domain_map{V_domain.data()};
+    EulerVecMap V_ghost_map{V_ghost.data()};
+
+    BC_container[find_patch_index(ij)]->calc_ghost_val(V_domain_map, V_ghost_map, face.S_ij.cast<Scalar>());
+
+    primvars.get_variable<StorageEulerVec>(face.j) = V_ghost.cast<StorageScalar>();
+}
+
+EulerVec EulerSolver::calc_boundary_primvars(Index ij, const EulerVec &V_i) const
+{
+    const auto &face = grid.get_faces()[ij];
+
+    if (store_ghost_cells)
+        return solver_data->get_primvars().get_variable<StorageEulerVec>(face.j).cast<Scalar>();
+
+    EulerVec V_domain{V_i};
+    EulerVec V_ghost;
+    EulerVecMap V_domain_map{V_domain.data()};
+    EulerVecMap V_ghost_map{V_ghost.data()};
+
+    BC_container[find_patch_index(ij)]->calc_ghost_val(V_domain_map, V_ghost_map, face.S_ij.cast<Scalar>());
+
+    return V_ghost;
+}
+
+template <typename EulerVecType>
+Scalar EulerSolver::subtract_viscous_flux(Index ij, bool boundary_face, EulerVecType &flux) const
+{
+    const auto &face = grid.get_faces()[ij];
+    const StorageVecField &primvars = solver_data->get_primvars();
+    const GradField &primvars_gradient = solver_data->get_primvars_gradient();
+
+    const EulerVec V_i = primvars.get_variable<StorageEulerVec>(face.i).cast<Scalar>();
+    const EulerGrad grad_i = primvars_gradient.get_variable<StorageEulerGrad>(face.i).cast<Scalar>();
+
+    /*The ghost cell of a boundary face has the gradient of its domain cell*/
+    EulerVec V_j;
+    EulerGrad grad_j;
+    if (boundary_face)
+    {
+        V_j = calc_boundary_primvars(ij, V_i);
+        grad_j = grad_i;
+    }
+    else
+    {
+        V_j = primvars.get_variable<StorageEulerVec>(face.j).cast<Scalar>();
+        grad_j = primvars_gradient.get_variable<StorageEulerGrad>(face.j).cast<Scalar>();
+    }
+
+    EulerVec flux_viscous;
+    const Scalar spectral_radius = NumericalFlux::calc_viscous_flux(V_i, V_j, grad_i, grad_j, (face.r_im - face.r_jm).cast<Scalar>(),
+                                                                    face.S_ij.cast<Scalar>(), viscosity, heat_conduction, flux_viscous);
+    flux -= flux_viscous;
+    return viscous_time_step_factor * spectral_radius;
+}
+
+void EulerSolver::add_scalar_face_fluxes(Index ij, bool boundary_face, Scalar mass_flux, bool update_i, bool update_j)
+{
+    const auto &face = grid.get_faces()[ij];
+    VecField &scalar_flux_balance = passive_scalars->get_flux_balance();
+
+    for_scalar_face_fluxes(ij, boundary_face, mass_flux, [&](ShortIndex k, Scalar flux)
+                           {
+        if (update_i)
+            scalar_flux_balance(face.i, k) -= flux;
+        if (update_j && !boundary_face)
+            scalar_flux_balance(face.j, k) += flux; });
+}
+
+void EulerSolver::gather_scalar_face_fluxes(Index i)
+{
+    const auto &faces = grid.get_faces();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = solver_data->get_solution().size();
+    VecField &scalar_flux_balance = passive_scalars->get_flux_balance();
+
+    for (ShortIndex k{0}; k < passive_scalars->get_N_SCALARS(); k++)
+        scalar_flux_balance(i, k) = 0.0;
+
+    /*In the order of the faces, as in the face loops of evaluate_inviscid_fluxes*/
+    for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+    {
+        const Index ij = cell_connectivity.face_indices[k];
+        const bool outgoing = faces[ij].i == i;
+        for_scalar_face_fluxes(ij, cell_connectivity.neighbours[k] >= N_INTERIOR_CELLS, face_fluxes[ij][0], [&](ShortIndex s, Scalar flux)
+                               {
+            if (outgoing)
+                scalar_flux_balance(i, s) -= flux;
+            else
+                scalar_flux_balance(i, s) += flux; });
+    }
+}
+
+Index EulerSolver::find_patch_index(Index ij) const
+{
+    const auto &patches = grid.get_patches();
+
+    for (Index i_patch{0}; i_patch < patches.size(); i_patch++)
+        if (ij < patches[i_patch].FIRST_FACE + patches[i_patch].N_FACES)
+        {
+            assert(ij >= patches[i_patch].FIRST_FACE);
+            return i_patch;
+        }
+
+    assert(false);
+    return 0;
+}
+
+template <typename Region>
+void EulerSolver::evaluate_gradient(const Config &config, const Region &region)
+{
+    const StorageVecField &primvars = solver_data->get_primvars();
     GradField &primvars_grad = solver_data->get_primvars_gradient();
 
+    auto boundary_value = [this](Index ij, const EulerVec &V_i)
+    { return calc_boundary_primvars(ij, V_i); };
+
     switch (config.get_grad_scheme())
     {
     case GradientScheme::GreenGauss:
-        Gradient::calc_green_gauss_gradient<N_EQS_EULER>(config, grid, primvars, primvars_grad);
+        /*The face loops of the kernel are serial, so with more threads the faces are summed per cell or
+        distributed over the threads, see Config::deterministic_accumulation*/
+        if constexpr (std::is_same_v<Region, WholeMesh>)
+            if (thread_pool.get_n_threads() > 1)
+            {
+                if (config.get_deterministic_accumulation())
+                    region.for_cells([&](Index i)
+                                     { Gradient::calc_green_gauss_cell_gradient<N_EQS_EULER>(i, grid, primvars, primvars_grad,
+                                                                                            config.get_N_INTERIOR_CELLS(), boundary_value); });
+                else
+                    Gradient::calc_green_gauss_gradient_atomic<N_EQS_EULER>(config, grid, primvars, primvars_grad, thread_pool, boundary_value);
+                break;
+            }
+        Gradient::calc_green_gauss_gradient<N_EQS_EULER>(config, grid, primvars, primvars_grad, region, boundary_value);
+        break;
+    case GradientScheme::LeastSquares:
+        Gradient::calc_least_squares_gradient<N_EQS_EULER>(config, grid, primvars, primvars_grad, region, boundary_value);
         break;
     default:
         assert(false); // no others are yet implemented
     }
 }
 
-void EulerSolver::evaluate_limiter(const Config &config)
+void EulerSolver::evaluate_kexact_fit(const Config &config)
+{
+    const StorageVecField &primvars = solver_data->get_primvars();
+    GradField &primvars_grad = solver_data->get_primvars_gradient();
+    HessianField &primvars_hessian = solver_data->get_primvars_hessian();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+
+    auto boundary_value = [this](Index ij, const EulerVec &V_i)
+    { return calc_boundary_primvars(ij, V_i); };
+
+    thread_pool.parallel_for(0, N_INTERIOR_CELLS, [&](Index i)
+                             { Reconstruction::calc_kexact_cell_fit<N_EQS_EULER>(i, grid, primvars, primvars_grad, primvars_hessian,
+                                                                                 N_INTERIOR_CELLS, boundary_value); });
+}
+
+template <Limiter LIMITER, typename Region>
+void EulerSolver::evaluate_limiter(const Config &config, const Region &region)
 {
 
-    const VecField &primvars = solver_data->get_primvars();
+    const StorageVecField &primvars = solver_data->get_primvars();
     const GradField &primvars_grad = solver_data->get_primvars_gradient();
-    VecField &primvars_limiter = solver_data->get_primvars_limiter();
-    VecField &primvars_max = solver_data->get_primvars_max();
-    VecField &primvars_min = solver_data->get_primvars_min();
-
-    switch (config.get_limiter())
-    {
-    case Limiter::Barth:
-        Reconstruction::calc_max_and_min_values<N_EQS_EULER>(config,
-                                                             grid,
-                                                             primvars,
-                                                             primvars_max,
-                                                             primvars_min);
-        Reconstruction::calc_barth_limiter<N_EQS_EULER>(config,
-                                                        grid,
-                                                        primvars,
-                                                        primvars_grad,
-                                                        primvars_max,
-                                                        primvars_min,
-                                                        primvars_limiter);
-        break;
-    default:
-        FAIL_MSG("Selected limiter not implemented\n");
+    StorageVecField &primvars_limiter = solver_data->get_primvars_limiter();
+
+    auto boundary_value = [this](Index ij, const EulerVec &V_i)
+    { return calc_boundary_primvars(ij, V_i); };
+
+    if (!config.get_limiter_shock_sensor())
+    {
+        Reconstruction::calc_limiter<LIMITER, N_EQS_EULER>(config, grid, primvars, primvars_grad, primvars_limiter, region, boundary_value);
+        return;
     }
+
+    /*The shock sensor is not used with temporal blocking, see ConfigParser::infer_hidden_options*/
+    assert((std::is_same_v<Region, WholeMesh>));
+
+    /*Resetting the cells limited in the previous evaluation before the new set is found*/
+    const EulerVec ones = EulerVec::Ones();
+    thread_pool.parallel_for(0, limited_cells.size(), [&](Index n)
+                             { primvars_limiter.set_variable(limited_cells[n], ones); });
+
+    Reconstruction::find_limited_cells(config, grid, primvars, limited_cells, limited_cell_marker, thread_pool, boundary_value);
+
+    Reconstruction::calc_limiter<LIMITER, N_EQS_EULER>(config, grid, primvars, primvars_grad, primvars_limiter, limited_cells,
+                                                       thread_pool, boundary_value);
+
+    n_limited_cells_step += limited_cells.size();
+    n_limiter_evaluations_step++;
 }
+
+void EulerSolver::report_limited_cells(const Config &config)
+{
+    if (n_limiter_evaluations_step == 0)
+        return;
+
+    Scalar active_fraction = static_cast<Scalar>(n_limited_cells_step) / (n_limiter_evaluations_step * config.get_N_INTERIOR_CELLS());
+    cout << "Limited cells: " << std::fixed << std::setprecision(2) << 100 * active_fraction << " %\n"
+         << std::defaultfloat << std::setprecision(6);
+
+    n_limited_cells_step = 0;
+    n_limiter_evaluations_step = 0;
+}
+
+void EulerSolver::update_activity(const Config &config)
+{
+    const VecField &U = solver_data->get_solution();
+    const VecField &U_old = solver_data->get_solution_old();
+    const CellConnectivity &cell_connectivity = grid.get_cell_connectivity();
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const Index BLOCK_SIZE = config.get_activity_block_size();
+    const Scalar tolerance = config.get_activity_tolerance();
+
+    /*Only the cells updated in the step can have changed*/
+    const Index n_updated_cells = active_region_only ? active_region.level_offsets[1] : N_INTERIOR_CELLS;
+    auto updated_cell = [&](Index c)
+    { return active_region_only ? active_region.cells[c] : c; };
+
+    thread_pool.parallel_for(0, n_updated_cells, [&](Index c)
+                             {
+        const Index i = updated_cell(c);
+        for (ShortIndex k{0}; k < N_EQS_EULER; k++)
+            if (std::abs(U(i, k) - U_old(i, k)) > tolerance * activity_scales[k])
+            {
+                activity_marker[i] = 1;
+                return;
+            }
+
+        /*The passive scalars are of order one, scaled by the free stream density*/
+        if (passive_scalars)
+            for (ShortIndex k{0}; k < passive_scalars->get_N_SCALARS(); k++)
+                if (std::abs(passive_scalars->get_solution()(i, k) - passive_scalars->get_solution_old()(i, k)) > tolerance * activity_scales[0])
+                {
+                    activity_marker[i] = 1;
+                    return;
+                } });
+
+    Vector<Index> marked_cells;
+    for (Index c{0}; c < n_updated_cells; c++)
+        if (activity_marker[updated_cell(c)])
+            marked_cells.push_back(updated_cell(c));
+
+    /*Safety halo around the changed cells, one layer of face neighbours at a time*/
+    Index first_in_layer{0};
+    for (ShortIndex layer{0}; layer < config.get_activity_halo(); layer++)
+    {
+        const Index end_of_layer = marked_cells.size();
+        for (Index c{first_in_layer}; c < end_of_layer; c++)
+        {
+            const Index i = marked_cells[c];
+            for (Index k{cell_connectivity.begin(i)}; k < cell_connectivity.end(i); k++)
+            {
+                const Index j = cell_connectivity.neighbours[k];
+                if (j < N_INTERIOR_CELLS && !activity_marker[j])
+                {
+                    activity_marker[j] = 1;
+                    marked_cells.push_back(j);
+                }
+            }
+        }
+        first_in_layer = end_of_layer;
+    }
+
+    Vector<uint8_t> active_blocks((N_INTERIOR_CELLS + BLOCK_SIZE - 1) / BLOCK_SIZE, 0);
+    for (Index i : marked_cells)
+    {
+        active_blocks[i / BLOCK_SIZE] = 1;
+        activity_marker[i] = 0;
+    }
+
+    Vector<Index> active_cells;
+    for (Index b{0}; b < active_blocks.size(); b++)
+        if (active_blocks[b])
+            for (Index i{b * BLOCK_SIZE}; i < std::min((b + 1) * BLOCK_SIZE, N_INTERIOR_CELLS); i++)
+                active_cells.push_back(i);
+
+    cout << "Active cells: " << std::fixed << std::setprecision(2)
+         << 100 * static_cast<Scalar>(n_updated_cells) / std::max<Index>(N_INTERIOR_CELLS, 1) << " %"
+         << (active_region_only ? "\n" : " (full sweep)\n")
+         << std::defaultfloat << std::setprecision(6);
+
+    create_active_region(config, active_cells);
+}
+
+void EulerSolver::update_limiter_freezing(const Config &config)
+{
+    if (limiter_frozen)
+        return;
+
+    const size_t n_finished_timesteps = config.get_timestep() + 1;
+
+    const size_t freeze_timestep = config.get_freeze_limiter_timestep();
+    if (freeze_timestep > 0 && n_finished_timesteps >= freeze_timestep)
+        limiter_frozen = true;
+
+    /*Same criterion as Config::convergence_tolerance, on the L2 norm of the density residual*/
+    const Scalar residual_drop = config.get_freeze_limiter_residual_drop();
+    if (residual_drop > 0.0 && n_finished_timesteps > 1 && residual_dropped(residual_drop))
+        limiter_frozen = true;
+
+    if (limiter_frozen)
+        cout << "Limiter frozen after time step " << n_finished_timesteps << "\n";
+}
+
+namespace
+{
+    /*--------------------------------------------------------------------
+    Resolving the runtime options to a compile time pipeline, one option
+    at a time. Options excluded from the build end up in the error branch.
+    --------------------------------------------------------------------*/
+
+    template <bool VISCOUS, TimeScheme TS, SpatialOrder SO, InviscidFluxScheme FS, Limiter LIM>
+    unique_ptr<Solver> create_euler_pipeline(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    {
+        if constexpr (VISCOUS && SO == SpatialOrder::First)
+            throw std::runtime_error("The viscous fluxes require spatial_order: Second or Third");
+        else if constexpr (pipeline::included(TS) && pipeline::included(SO) && pipeline::included(FS) && pipeline::included(LIM) &&
+                           pipeline::included_viscous(VISCOUS))
+            return make_unique<EulerSolverPipeline<pipeline::Options<TS, SO, FS, LIM, VISCOUS>>>(config, grid, thread_pool);
+        else
+            throw std::runtime_error("The selected combination of solver options has been excluded from the build");
+    }
+
+    template <bool VISCOUS, TimeScheme TS, SpatialOrder SO, InviscidFluxScheme FS>
+    unique_ptr<Solver> select_limiter(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    {
+        if constexpr (SO != SpatialOrder::Second)
+            return create_euler_pipeline<VISCOUS, TS, SO, FS, Limiter::NONE>(config, grid, thread_pool);
+        else
+        {
+            switch (config.get_limiter())
+            {
+            case Limiter::NONE:
+                return create_euler_pipeline<VISCOUS, TS, SO, FS, Limiter::NONE>(config, grid, thread_pool);
+            case Limiter::Barth:
+                return create_euler_pipeline<VISCOUS, TS, SO, FS, Limiter::Barth>(config, grid, thread_pool);
+            case Limiter::Venkatakrishnan:
+                return create_euler_pipeline<VISCOUS, TS, SO, FS, Limiter::Venkatakrishnan>(config, grid, thread_pool);
+            default:
+                throw std::runtime_error("Selected limiter not implemented");
+            }
+        }
+    }
+
+    template <bool VISCOUS, TimeScheme TS, SpatialOrder SO>
+    unique_ptr<Solver> select_inv_flux_scheme(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    {
+        switch (config.get_inv_flux_scheme())
+        {
+        case InviscidFluxScheme::Rusanov:
+            return select_limiter<VISCOUS, TS, SO, InviscidFluxScheme::Rusanov>(config, grid, thread_pool);
+        case InviscidFluxScheme::HLLC:
+            return select_limiter<VISCOUS, TS, SO, InviscidFluxScheme::HLLC>(config, grid, thread_pool);
+        default:
+            throw std::runtime_error("Selected inviscid flux scheme not implemented");
+        }
+    }
+
+    template <bool VISCOUS, TimeScheme TS>
+    unique_ptr<Solver> select_spatial_order(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    {
+        switch (config.get_spatial_order())
+        {
+        case SpatialOrder::First:
+            return select_inv_flux_scheme<VISCOUS, TS, SpatialOrder::First>(config, grid, thread_pool);
+        case SpatialOrder::Second:
+            return select_inv_flux_scheme<VISCOUS, TS, SpatialOrder::Second>(config, grid, thread_pool);
+        case SpatialOrder::Third:
+            return select_inv_flux_scheme<VISCOUS, TS, SpatialOrder::Third>(config, grid, thread_pool);
+        default:
+            throw std::runtime_error("Selected spatial order not implemented");
+        }
+    }
+
+    template <bool VISCOUS>
+    unique_ptr<Solver> select_time_scheme(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+    {
+        switch (config.get_time_scheme())
+        {
+        case TimeScheme::ExplicitEuler:
+            return select_spatial_order<VISCOUS, TimeScheme::ExplicitEuler>(config, grid, thread_pool);
+        case TimeScheme::TVD_RK3:
+            return select_spatial_order<VISCOUS, TimeScheme::TVD_RK3>(config, grid, thread_pool);
+        case TimeScheme::LUSGS:
+            return select_spatial_order<VISCOUS, TimeScheme::LUSGS>(config, grid, thread_pool);
+        default:
+            throw std::runtime_error("Selected time scheme not implemented");
+        }
+    }
+}
+
+unique_ptr<Solver> EulerSolver::create(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+{
+    return select_time_scheme<false>(config, grid, thread_pool);
+}
+
+unique_ptr<Solver> NS_Solver::create(const Config &config, const geom::Grid &grid, ThreadPool &thread_pool)
+{
+    return select_time_scheme<true>(config, grid, thread_pool);
+}
\ No newline at end of file
@@ -1,24 +1,37 @@
 #include "../include/SolverData.hpp"
 
-SolverData::SolverData(const Config &config, ShortIndex n_eqs)
+SolverData::SolverData(const Config &config, ShortIndex n_eqs, ThreadPool &thread_pool)
 {
     Index N_TOTAL_CELLS = config.get_N_TOTAL_CELLS();
     Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
 
-    solution = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs);
-    solution_old = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs);
-    primvars = make_unique<VecField>(N_TOTAL_CELLS, n_eqs);
-    flux_balance = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs);
+    const FieldAllocator allocator{config.get_huge_pages(), &thread_pool};
 
-    primvars_gradient = make_unique<GradField>(N_INTERIOR_CELLS, n_eqs);
-    primvars_limiter = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs);
-    primvars_max = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs); //?correct size
-    primvars_min = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs); //?correct size
+    solution = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+    solution_old = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+    flux_balance = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+    primvars = make_unique<StorageVecField>(config.get_store_ghost_cells() ? N_TOTAL_CELLS : N_INTERIOR_CELLS, n_eqs, allocator);
+
+    primvars_gradient = make_unique<GradField>(N_INTERIOR_CELLS, n_eqs, allocator);
+    primvars_limiter = make_unique<StorageVecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+
+    if (config.get_spatial_order() == SpatialOrder::Third)
+        primvars_hessian = make_unique<HessianField>(N_INTERIOR_CELLS, n_eqs, allocator);
+
+    if (config.get_temporal_block_size_kb() > 0)
+    {
+        solution_stage_1 = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+        solution_stage_2 = make_unique<VecField>(N_INTERIOR_CELLS, n_eqs, allocator);
+    }
+
+    if (config.get_local_time_stepping())
+        local_delta_time.resize(N_INTERIOR_CELLS);
 }
 
-EulerSolverData::EulerSolverData(const Config &config) : SolverData(config, N_EQS_EULER)
+EulerSolverData::EulerSolverData(const Config &config, ThreadPool &thread_pool)
+    : SolverData(config, N_EQS_EULER, thread_pool)
 {
-    Delta_S.resize(config.get_N_TOTAL_CELLS());
+    spectral_radii.resize(config.get_N_INTERIOR_CELLS());
 
     switch (config.get_initial_cond_option())
     {
@@ -32,15 +45,11 @@ EulerSolverData::EulerSolverData(const Config &config) : SolverData(config, N_EQ
 
 void EulerSolverData::set_primvars(const VecField &cons_vars, const Config &config)
 {
-    assert(cons_vars.size() == config.get_N_INTERIOR_CELLS() && primvars->size() == config.get_N_TOTAL_CELLS());
+    assert(cons_vars.size() == config.get_N_INTERIOR_CELLS() &&
+           primvars->size() == (config.get_store_ghost_cells() ? config.get_N_TOTAL_CELLS() : config.get_N_INTERIOR_CELLS()));
     assert(cons_vars.get_N_EQS() == primvars->get_N_EQS());
 
-    for (Index i{0}; i < config.get_N_INTERIOR_CELLS(); i++)
-    {
-        const EulerVecMap U = cons_vars.get_variable<EulerVec>(i);
-        EulerVecMap V = primvars->get_variable<EulerVec>(i);
-        EulerEqs::cons_to_prim(U, V);
-    }
+    set_primvars(cons_vars, 0, config.get_N_INTERIOR_CELLS());
 }
 
 void EulerSolverData::set_freestream_values(const Config &config)
@@ -49,8 +58,27 @@ void EulerSolverData::set_freestream_values(const Config &config)
     EulerVec U_inf{};
     Index first{0}, last{config.get_N_INTERIOR_CELLS()};
     EulerEqs::prim_to_cons(V_inf, U_inf);
-    primvars->set_constant_field_segment(V_inf, first, last);
+    primvars->set_constant_field_segment(StorageEulerVec{V_inf.cast<StorageScalar>()}, first, last);
     solution->set_constant_field_segment(U_inf, first, last);
+    solution_old->set_constant_field_segment(U_inf, first, last);
+}
+
+PassiveScalarData::PassiveScalarData(const Config &config, ThreadPool &thread_pool)
+    : freestream_values{config.get_passive_scalar_freestream_values()}
+{
+    const Index N_INTERIOR_CELLS = config.get_N_INTERIOR_CELLS();
+    const ShortIndex N_SCALARS = config.get_N_PASSIVE_SCALARS();
+    const FieldAllocator allocator{config.get_huge_pages(), &thread_pool};
+
+    solution = make_unique<VecField>(N_INTERIOR_CELLS, N_SCALARS, allocator);
+    solution_old = make_unique<VecField>(N_INTERIOR_CELLS, N_SCALARS, allocator);
+    flux_balance = make_unique<VecField>(N_INTERIOR_CELLS, N_SCALARS, allocator);
+
+    const Scalar density = config.get_primvars_inf(primvars_index::Density);
+    for (Index i{0}; i < N_INTERIOR_CELLS; i++)
+        for (ShortIndex k{0}; k < N_SCALARS; k++)
+            (*solution)(i, k) = density * config.get_passive_scalar_initial_values()[k];
+    *solution_old = *solution;
 }
 
 ValidityChecker::ValidityChecker(const Config &config) : config{config}
@@ -93,7 +121,7 @@ Index ValidityChecker::check_field_validity(const VecField &field, Index first,
     return invalid_cells;
 }
 
-Index EulerValidityChecker::check_primvars(const VecField &V, Index first, Index last) const
+Index EulerValidityChecker::check_primvars(const StorageVecField &V, Index first, Index last) const
 {
 
     assert(first >= 0 && last <= V.size());
@@ -125,28 +153,39 @@ Index EulerValidityChecker::check_consvars(const VecField &U, Index first, Index
     assert(first >= 0 && last <= U.size());
     assert(U.get_N_EQS() == N_EQS_EULER);
     Index invalid_cells{0};
-    for (Index i{first}; i < last; i++)
+
+    /*The pressures are computed batch by batch*/
+    constexpr Index BATCH_SIZE{256};
+    array<Scalar, BATCH_SIZE> p;
+
+    for (Index batch_first{first}; batch_first < last; batch_first += BATCH_SIZE)
     {
-        /*Checking density and total energy*/
-        if (!num_is_valid_and_pos(U(i, 0)) || !num_is_valid_and_pos(U(i, 4)))
-        {
-            invalid_cells += 1;
-            continue;
-        }
-        /*Checking momentum*/
-        for (ShortIndex i_dim{1}; i_dim <= N_DIM; i_dim++)
+        const Index batch_last = std::min(batch_first + BATCH_SIZE, last);
+        EulerEqs::pressure(U, batch_first, batch_last, p.data());
+
+        for (Index i{batch_first}; i < batch_last; i++)
         {
-            if (!num_is_valid(U(i, i_dim)))
+            /*Checking density, total energy and pressure*/
+            if (!num_is_valid_and_pos(U(i, 0)) || !num_is_valid_and_pos(U(i, 4)) || !num_is_valid_and_pos(p[i - batch_first]))
             {
                 invalid_cells += 1;
-                break;
+                continue;
+            }
+            /*Checking momentum*/
+            for (ShortIndex i_dim{1}; i_dim <= N_DIM; i_dim++)
+            {
+                if (!num_is_valid(U(i, i_dim)))
+                {
+                    invalid_cells += 1;
+                    break;
+                }
             }
         }
     }
     return invalid_cells;
 }
 
-bool ValidityChecker::valid_primvars_interior(const VecField &V) const
+bool ValidityChecker::valid_primvars_interior(const StorageVecField &V) const
 {
     if (check_primvars(V, 0, config.get_N_INTERIOR_CELLS()) > 0)
     {
@@ -166,9 +205,9 @@ bool ValidityChecker::valid_consvars_interior(const VecField &U) const
     return true;
 }
 
-bool ValidityChecker::valid_primvars_ghost(const VecField &V) const
+bool ValidityChecker::valid_primvars_ghost(const StorageVecField &V) const
 {
-    if (check_consvars(V, config.get_N_INTERIOR_CELLS(), V.size()) > 0)
+    if (check_primvars(V, config.get_N_INTERIOR_CELLS(), V.size()) > 0)
     {
         write_debug_info(V);
         return false;
@@ -196,26 +235,6 @@ bool ValidityChecker::valid_flux_balance(const VecField &R) const
     return true;
 }
 
-void ValidityChecker::write_debug_info(const VecField &U, string name) const
-{
-    std::ofstream ost{DEBUG_LOG_FILE, std::ios::app};
-    FAIL_IF_MSG(!ost, "Couldn't open file debugging logging file " + string(DEBUG_LOG_FILE));
-
-    ost << "\n\nDisplaying vector field " + name + "\n\n";
-    for (Index i{0}; i < U.size(); i++)
-    {
-        for (ShortIndex j{0}; j < U.get_N_EQS(); j++)
-        {
-            ost << U(i, j);
-            if (j < U.get_N_EQS() - 1)
-                ost << ", ";
-        }
-        if (i >= config.get_N_INTERIOR_CELLS())
-            ost << " -G";
-        ost << "\n";
-    }
-}
-
 bool EulerValidityChecker::valid_boundary_flux(const Scalar *flux_vals, BoundaryType bc_type) const
 {
     const EulerVec flux = EulerVec{flux_vals};
@@ -0,0 +1,332 @@
+#include "../include/ThreadPool.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    /*CPUs the process may run on*/
+    Vector<int> allowed_cpus()
+    {
+        Vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+            for (int cpu{0}; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &cpu_set))
+                    cpus.push_back(cpu);
+#endif
+        if (cpus.empty())
+            for (int cpu{0}; cpu < static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)); cpu++)
+                cpus.push_back(cpu);
+        return cpus;
+    }
+
+    /*Allowed CPUs of each NUMA node with any, by increasing node number. A single node 0 holding all allowed CPUs
+    if the topology is not available*/
+    map<int, Vector<int>> numa_nodes(const Vector<int> &cpus)
+    {
+        map<int, Vector<int>> nodes;
+        const string node_dir = "/sys/devices/system/node";
+
+        std::error_code error;
+        for (const auto &entry : filesys::directory_iterator(node_dir, error))
+        {
+            const string name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.find_first_not_of("0123456789", 4) != string::npos || name.size() == 4)
+                continue;
+
+            std::ifstream ist{entry.path() / "cpulist"};
+            string cpu_list;
+            if (!std::getline(ist, cpu_list))
+                continue;
+
+            for (int cpu : parse_cpu_list(cpu_list))
+                if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+                    nodes[std::stoi(name.substr(4))].push_back(cpu);
+        }
+
+        if (nodes.empty())
+            nodes[0] = cpus;
+        return nodes;
+    }
+
+    /*Pins thread, or the calling thread if nullptr, to core*/
+    bool pin_to_core([[maybe_unused]] std::thread *thread, [[maybe_unused]] int core)
+    {
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(core, &cpu_set);
+        return pthread_setaffinity_np(thread ? thread->native_handle() : pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+        return false;
+#endif
+    }
+}
+
+Vector<ThreadPool::WorkerPlacement> ThreadPool::select_worker_cores(ThreadAffinity affinity, const Vector<int> &core_list,
+                                                                      ShortIndex n_threads)
+{
+    if (affinity == ThreadAffinity::None)
+        return {};
+
+    const Vector<int> cpus = allowed_cpus();
+    const map<int, Vector<int>> nodes = numa_nodes(cpus);
+
+    auto node_of = [&](int core)
+    {
+        for (const auto &[node, node_cpus] : nodes)
+            if (std::find(node_cpus.begin(), node_cpus.end(), core) != node_cpus.end())
+                return node;
+        throw std::runtime_error("Core " + std::to_string(core) + " is not available to the process");
+    };
+
+    Vector<WorkerPlacement> placement;
+    switch (affinity)
+    {
+    case ThreadAffinity::Compact:
+    {
+        Vector<WorkerPlacement> node_major;
+        for (const auto &[node, node_cpus] : nodes)
+            for (int cpu : node_cpus)
+                node_major.push_back({cpu, node});
+        for (ShortIndex worker{0}; worker < n_threads; worker++)
+            placement.push_back(node_major[worker % node_major.size()]);
+        break;
+    }
+    case ThreadAffinity::Scatter:
+    {
+        Vector<pair<int, const Vector<int> *>> node_list;
+        for (const auto &[node, node_cpus] : nodes)
+            node_list.emplace_back(node, &node_cpus);
+        for (ShortIndex worker{0}; worker < n_threads; worker++)
+        {
+            const auto &[node, node_cpus] = node_list[worker % node_list.size()];
+            placement.push_back({(*node_cpus)[worker / node_list.size() % node_cpus->size()], node});
+        }
+        break;
+    }
+    case ThreadAffinity::List:
+        assert(core_list.size() >= n_threads);
+        for (ShortIndex worker{0}; worker < n_threads; worker++)
+            placement.push_back({core_list[worker], node_of(core_list[worker])});
+        break;
+    default:
+        assert(false);
+    }
+
+    if (n_threads > cpus.size())
+        cout << "Warning: " << n_threads << " threads share " << cpus.size() << " available cores\n";
+
+    return placement;
+}
+
+ThreadPool::ThreadPool(ShortIndex n_threads, Index chunk_size, const Vector<WorkerPlacement> &worker_cores)
+    : n_threads{n_threads}, chunk_size{chunk_size}, worker_cores{worker_cores}
+{
+    assert(n_threads > 0 && chunk_size > 0);
+    assert(worker_cores.empty() || worker_cores.size() == n_threads);
+
+    queues = make_unique<ChunkQueue[]>(n_threads);
+    worker_statistics = make_unique<PaddedStatistics[]>(n_threads);
+
+    for (ShortIndex worker{1}; worker < n_threads; worker++)
+        threads.emplace_back(&ThreadPool::worker_loop, this, worker);
+
+    /*The calling thread is worker 0. Threads it creates later inherit its single core, so all parallel work,
+    including the flux balance task graph, has to run on the pool*/
+    if (!worker_cores.empty())
+        for (ShortIndex worker{0}; worker < n_threads; worker++)
+            if (!pin_to_core(worker == 0 ? nullptr : &threads[worker - 1], worker_cores[worker].core))
+                cout << "Warning: could not pin worker " << worker << " to core " << worker_cores[worker].core << "\n";
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    start_condition.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void ThreadPool::run(Index n_chunks, ChunkFunction chunk_function, const void *context)
+{
+    for (ShortIndex worker{0}; worker < n_threads; worker++)
+    {
+        const auto [begin, end] = initial_chunks(worker, n_chunks);
+        queues[worker].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    run_chunk = chunk_function;
+    chunk_context = context;
+
+    if (n_threads > 1)
+    {
+        /*Locking the mutex publishes the queues and the loop to the workers*/
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            generation++;
+            n_busy_workers = n_threads - 1;
+        }
+        start_condition.notify_all();
+    }
+
+    work(0);
+
+    if (n_threads > 1)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        done_condition.wait(lock, [this]
+                            { return n_busy_workers == 0; });
+    }
+
+    if (exception)
+    {
+        std::exception_ptr first_exception = exception;
+        exception = nullptr;
+        std::rethrow_exception(first_exception);
+    }
+}
+
+void ThreadPool::worker_loop(ShortIndex worker)
+{
+    size_t last_generation{0};
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            start_condition.wait(lock, [&]
+                                 { return stopping || generation != last_generation; });
+            if (stopping)
+                return;
+            last_generation = generation;
+        }
+
+        work(worker);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (--n_busy_workers == 0)
+                done_condition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work(ShortIndex worker)
+{
+    Index chunk;
+    while (true)
+    {
+        while (pop_chunk(worker, chunk))
+            run_chunk_timed(worker, chunk);
+
+        /*The victims are tried in order starting from the next worker. The loop is done for this worker when all
+        queues are empty. Chunks being moved by another thief are run by that thief*/
+        bool stolen{false};
+        for (ShortIndex k{1}; k < n_threads && !stolen; k++)
+            stolen = steal_chunks(worker, (worker + k) % n_threads);
+
+        if (!stolen)
+            return;
+    }
+}
+
+bool ThreadPool::pop_chunk(ShortIndex worker, Index &chunk)
+{
+    std::atomic<uint64_t> &range = queues[worker].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+
+    while (range_begin(current) < range_end(current))
+    {
+        if (range.compare_exchange_weak(current, pack(range_begin(current) + 1, range_end(current)),
+                                        std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            chunk = range_begin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal_chunks(ShortIndex thief, ShortIndex victim)
+{
+    std::atomic<uint64_t> &range = queues[victim].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+
+    while (range_begin(current) < range_end(current))
+    {
+        /*Half of the remaining chunks, rounded up, are taken from the back*/
+        const Index n_stolen = (range_end(current) - range_begin(current) + 1) / 2;
+        const Index split = range_end(current) - n_stolen;
+
+        if (range.compare_exchange_weak(current, pack(range_begin(current), split),
+                                        std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            /*The own queue is empty, so no other thief touches it before it is refilled*/
+            queues[thief].range.store(pack(split, range_end(current)), std::memory_order_release);
+
+            WorkerStatistics &statistics = worker_statistics[thief].statistics;
+            statistics.n_steals++;
+            statistics.n_stolen_chunks += n_stolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_chunk_timed(ShortIndex worker, Index chunk)
+{
+    WorkerStatistics &statistics = worker_statistics[worker].statistics;
+    const auto start_time = Clock::now();
+
+    /*The remaining chunks are still run after an exception, the first exception is rethrown by run*/
+    try
+    {
+        run_chunk(chunk_context, chunk);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{exception_mutex};
+        if (!exception)
+            exception = std::current_exception();
+    }
+
+    statistics.busy_seconds += std::chrono::duration<double>(Clock::now() - start_time).count();
+    statistics.n_chunks++;
+}
+
+void ThreadPool::print_statistics() const
+{
+    cout << "Thread pool of " << n_threads << " threads, chunks of " << chunk_size << " indices:\n";
+    for (ShortIndex worker{0}; worker < n_threads; worker++)
+    {
+        const WorkerStatistics &statistics = worker_statistics[worker].statistics;
+        cout << "    worker " << std::left << std::setw(6) << worker << std::right
+             << std::setw(12) << statistics.busy_seconds << " s busy"
+             << std::setw(12) << statistics.n_chunks << " chunks"
+             << std::setw(12) << statistics.n_stolen_chunks << " stolen in"
+             << std::setw(10) << statistics.n_steals << " steals\n";
+    }
+}
+
+void ThreadPool::print_placement(Index n_cells) const
+{
+    const Index n_chunks = (n_cells + chunk_size - 1) / chunk_size;
+
+    cout << "Thread pool of " << n_threads << " threads" << (worker_cores.empty() ? ", not pinned" : "") << ":\n";
+    for (ShortIndex worker{0}; worker < n_threads; worker++)
+    {
+        const auto [begin, end] = initial_chunks(worker, n_chunks);
+        cout << "    worker " << std::left << std::setw(6) << worker << std::right;
+        if (!worker_cores.empty())
+            cout << "core " << std::setw(5) << worker_cores[worker].core << "   NUMA node " << std::setw(3) << worker_cores[worker].numa_node << "   ";
+        cout << "cells [" << std::min(begin * chunk_size, n_cells) << ", " << std::min(end * chunk_size, n_cells) << ")\n";
+    }
+}
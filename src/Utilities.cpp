@@ -65,6 +65,16 @@ namespace geom
         return 0.25 * (nodes[0] + nodes[1] + nodes[2] + nodes[3]); // 1/4(a + b + c + d)
     }
 
+    QuadraticVec Tetrahedron::calc_second_moments() const
+    {
+        // The covariance of a tetrahedron about its centroid c is 1/20 * sum_k (x_k - c)(x_k - c)^T
+        const Vec3 centroid = calc_centroid();
+        QuadraticVec moments = QuadraticVec::Zero();
+        for (const Vec3 &node : nodes)
+            moments += quadratic_monomials(node - centroid);
+        return moments / 20;
+    }
+
     Face create_face_from_geom(Index i, Index j, const Facegeom &face_geom, Vec3 cell_center_i, Vec3 cell_center_j)
     {
         Vec3 face_centroid = face_geom.calc_centroid();
@@ -79,10 +89,10 @@ namespace geom
         assert(normal_dot_product != 0); // Just banning this for now, altough it is possibly possible with a high skewness, but valid mesh
         if (normal_dot_product < 0)
             S_ij *= -1; // Flipping normal if it's not pointing from i to j
-        face.S_ij = S_ij;
+        face.S_ij = S_ij.cast<StorageScalar>();
         Vec3 face_centroid = face_geom.calc_centroid();
-        face.r_im = cell_center_i - face_centroid;
-        face.r_jm = cell_center_j - face_centroid;
+        face.r_im = (face_centroid - cell_center_i).cast<StorageScalar>();
+        face.r_jm = (face_centroid - cell_center_j).cast<StorageScalar>();
     }
     Vec3 calc_ghost_centroid(Vec3 centroid_i, const Facegeom &boundary_face)
     {